@@ -0,0 +1,291 @@
+#include <algorithm>
+
+#include "alphabet.hpp"
+
+namespace
+{
+	// a code point we can make words of, once lower cased. past ascii that's
+	// anything from latin-1's letters up but for the signs and punctuation
+	// that turn up in word lists, and the accents that combine with the
+	// letter before them
+	bool isWordLetter( std::uint32_t code ) throw()
+	{
+		if ( code < 0x80 )
+			return code >= 'a' && code <= 'z';
+
+		return code >= 0xc0 && code != 0xd7 && code != 0xf7 && ( code < 0x300 || code >= 0x370 ) && ( code < 0x2000 || code >= 0x2c00 );
+	}
+
+	// the capitals and small letters of latin extended-a alternate, a pair
+	// to every two code points, but not always starting on an even one
+	bool pairedEven( std::uint32_t code ) throw()
+	{
+		return ( code >= 0x100 && code <= 0x12f ) || ( code >= 0x132 && code <= 0x137 ) || ( code >= 0x14a && code <= 0x177 );
+	}
+
+	bool pairedOdd( std::uint32_t code ) throw()
+	{
+		return ( code >= 0x139 && code <= 0x148 ) || ( code >= 0x179 && code <= 0x17e );
+	}
+}
+
+alphabet::alphabet( std::vector< std::uint32_t > const & more )
+{
+	for ( char c = 'a' ; c <= 'z' ; ++c )
+		_codes.push_back( static_cast< std::uint32_t >( c ) );
+
+	for ( auto const & code : more )
+	{
+		_beyond.emplace_back( code, static_cast< std::uint8_t >( _codes.size() ) );
+		_codes.push_back( code );
+	}
+
+	std::sort( _beyond.begin(), _beyond.end() );
+}
+
+bool alphabet::encode( std::string const & text, std::string & letters ) const throw()
+{
+	letters.clear();
+
+	char const * p = text.data();
+	char const * end = p + text.size();
+	std::uint32_t code;
+
+	while ( next( p, end, code ) )
+	{
+		if ( code == ' ' || code == '.' || code == '?' )
+		{
+			letters += static_cast< char >( code );
+			continue;
+		}
+
+		code = lower( code );
+
+		if ( code >= 'a' && code <= 'z' )
+		{
+			letters += static_cast< char >( code );
+			continue;
+		}
+
+		auto at = std::lower_bound( _beyond.begin(), _beyond.end(), std::make_pair( code, std::uint8_t( 0 ) ) );
+
+		if ( at == _beyond.end() || at->first != code )
+			return false;
+
+		letters += letterAt( at->second );
+	}
+
+	return p == end;
+}
+
+std::string alphabet::decode( char const * letters, std::size_t n ) const throw()
+{
+	std::string text;
+
+	for ( std::size_t i = 0 ; i < n ; ++i )
+	{
+		std::size_t l = letterIndex( letters[ i ] );
+
+		if ( l < _codes.size() )
+			append( _codes[ l ], text );
+		else
+			text += letters[ i ];
+	}
+
+	return text;
+}
+
+std::string alphabet::decode( std::string const & letters ) const throw()
+{
+	return decode( letters.data(), letters.size() );
+}
+
+std::string alphabet::capital( char c ) const throw()
+{
+	std::string text;
+	std::size_t l = letterIndex( c );
+
+	if ( l < _codes.size() )
+		append( upper( _codes[ l ] ), text );
+	else
+		text += c;
+
+	return text;
+}
+
+bool alphabet::fold( std::string const & word, std::string & folded ) throw()
+{
+	folded.clear();
+
+	char const * p = word.data();
+	char const * end = p + word.size();
+	std::uint32_t code;
+
+	while ( next( p, end, code ) )
+	{
+		code = lower( code );
+
+		if ( !isWordLetter( code ) )
+			return false;
+
+		append( code, folded );
+	}
+
+	return p == end;
+}
+
+std::size_t alphabet::length( std::string const & text ) throw()
+{
+	std::size_t n = 0;
+
+	char const * p = text.data();
+	char const * end = p + text.size();
+	std::uint32_t code;
+
+	while ( next( p, end, code ) )
+		++n;
+
+	// a badly formed byte counts as one so the length is never short
+	return n + ( end - p );
+}
+
+bool alphabet::next( char const * & p, char const * end, std::uint32_t & code ) throw()
+{
+	if ( p >= end )
+		return false;
+
+	unsigned char b = static_cast< unsigned char >( *p );
+
+	if ( b < 0x80 )
+	{
+		code = b;
+		++p;
+		return true;
+	}
+
+	std::size_t more;
+	std::uint32_t least;
+
+	if ( ( b & 0xe0 ) == 0xc0 )
+	{
+		more = 1;
+		least = 0x80;
+		code = b & 0x1f;
+	}
+	else if ( ( b & 0xf0 ) == 0xe0 )
+	{
+		more = 2;
+		least = 0x800;
+		code = b & 0x0f;
+	}
+	else if ( ( b & 0xf8 ) == 0xf0 )
+	{
+		more = 3;
+		least = 0x10000;
+		code = b & 0x07;
+	}
+	else
+		return false;
+
+	if ( std::size_t( end - p ) <= more )
+		return false;
+
+	for ( std::size_t i = 1 ; i <= more ; ++i )
+	{
+		unsigned char c = static_cast< unsigned char >( p[ i ] );
+
+		if ( ( c & 0xc0 ) != 0x80 )
+			return false;
+
+		code = ( code << 6 ) | ( c & 0x3f );
+	}
+
+	// overlong forms and surrogates aren't utf-8
+	if ( code < least || code > 0x10ffff || ( code >= 0xd800 && code < 0xe000 ) )
+		return false;
+
+	p += more + 1;
+
+	return true;
+}
+
+void alphabet::append( std::uint32_t code, std::string & text ) throw()
+{
+	if ( code < 0x80 )
+		text += static_cast< char >( code );
+	else if ( code < 0x800 )
+	{
+		text += static_cast< char >( 0xc0 | ( code >> 6 ) );
+		text += static_cast< char >( 0x80 | ( code & 0x3f ) );
+	}
+	else if ( code < 0x10000 )
+	{
+		text += static_cast< char >( 0xe0 | ( code >> 12 ) );
+		text += static_cast< char >( 0x80 | ( ( code >> 6 ) & 0x3f ) );
+		text += static_cast< char >( 0x80 | ( code & 0x3f ) );
+	}
+	else
+	{
+		text += static_cast< char >( 0xf0 | ( code >> 18 ) );
+		text += static_cast< char >( 0x80 | ( ( code >> 12 ) & 0x3f ) );
+		text += static_cast< char >( 0x80 | ( ( code >> 6 ) & 0x3f ) );
+		text += static_cast< char >( 0x80 | ( code & 0x3f ) );
+	}
+}
+
+std::uint32_t alphabet::lower( std::uint32_t code ) throw()
+{
+	if ( code >= 'A' && code <= 'Z' )
+		return code + 0x20;
+
+	// latin-1
+	if ( code >= 0xc0 && code <= 0xde && code != 0xd7 )
+		return code + 0x20;
+
+	// latin extended-a
+	if ( ( pairedEven( code ) && code % 2 == 0 ) || ( pairedOdd( code ) && code % 2 == 1 ) )
+		return code + 1;
+
+	if ( code == 0x178 )
+		return 0xff;
+
+	// greek and cyrillic
+	if ( code >= 0x391 && code <= 0x3a9 && code != 0x3a2 )
+		return code + 0x20;
+
+	if ( code >= 0x410 && code <= 0x42f )
+		return code + 0x20;
+
+	if ( code >= 0x400 && code <= 0x40f )
+		return code + 0x50;
+
+	return code;
+}
+
+std::uint32_t alphabet::upper( std::uint32_t code ) throw()
+{
+	if ( code >= 'a' && code <= 'z' )
+		return code - 0x20;
+
+	// latin-1, ß has no capital of its own
+	if ( code >= 0xe0 && code <= 0xfe && code != 0xf7 )
+		return code - 0x20;
+
+	if ( code == 0xff )
+		return 0x178;
+
+	if ( ( pairedEven( code ) && code % 2 == 1 ) || ( pairedOdd( code ) && code % 2 == 0 ) )
+		return code - 1;
+
+	// a final sigma is only ever small
+	if ( code >= 0x3b1 && code <= 0x3c9 && code != 0x3c2 )
+		return code - 0x20;
+
+	if ( code >= 0x430 && code <= 0x44f )
+		return code - 0x20;
+
+	if ( code >= 0x450 && code <= 0x45f )
+		return code - 0x50;
+
+	return code;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// the most letters a word list can use, a-z and up to 38 more
+#define MAX_LETTERS 64
+
+// a word list of only a-z, the grid and search are built for these as well
+// so the usual case doesn't carry masks for letters it never has
+#define ENGLISH_LETTERS 26
+
+// the search never sees a letter as it's written. each letter of the word
+// list is a byte from 'a' up, numbered in the order of the list's alphabet,
+// so a letter indexes a table MAX_LETTERS wide straight off whatever the
+// language. a-z are always the first 26, so english reads the same
+inline std::size_t letterIndex( char c ) throw() { return std::size_t( static_cast< unsigned char >( c ) ) - 'a'; }
+inline char letterAt( std::size_t i ) throw() { return static_cast< char >( 'a' + i ); }
+inline bool isLetter( char c ) throw() { return letterIndex( c ) < MAX_LETTERS; }
+
+// the letters of a word list and the way between them and utf-8. a word
+// list in another language numbers the letters it uses beyond a-z in code
+// point order, the dictionary image keeps them with the words
+class alphabet
+{
+public:
+	// a-z, then the given code points
+	explicit alphabet( std::vector< std::uint32_t > const & more = std::vector< std::uint32_t >() );
+
+	inline std::size_t size() const throw() { return _codes.size(); }
+	inline std::uint32_t code( std::size_t i ) const throw() { return _codes[ i ]; }
+
+	// utf-8 text as letters, lower case. ' ', '.' and '?' stay as they
+	// are, false for anything else that isn't one of the letters
+	bool encode( std::string const & text, std::string & letters ) const throw();
+
+	// letters as utf-8, anything that isn't a letter is copied as it is
+	std::string decode( char const * letters, std::size_t n ) const throw();
+	std::string decode( std::string const & letters ) const throw();
+
+	// one letter as a capital, for showing where a word is in the grid
+	std::string capital( char c ) const throw();
+
+	// a word of utf-8 in lower case, false if it isn't all letters
+	static bool fold( std::string const & word, std::string & folded ) throw();
+
+	// the code points in utf-8 text
+	static std::size_t length( std::string const & text ) throw();
+
+	// the next code point of utf-8 text, false at the end or if it's badly formed
+	static bool next( char const * & p, char const * end, std::uint32_t & code ) throw();
+
+	static void append( std::uint32_t code, std::string & text ) throw();
+
+	// case for latin, greek and cyrillic, everything else is left alone
+	static std::uint32_t lower( std::uint32_t code ) throw();
+	static std::uint32_t upper( std::uint32_t code ) throw();
+
+private:
+	std::vector< std::uint32_t >							_codes;
+	std::vector< std::pair< std::uint32_t, std::uint8_t > >	_beyond;	// the letters past z by code point, sorted
+};
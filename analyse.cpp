@@ -1,76 +1,328 @@
 #include <iostream>
+#include <fstream>
 #include <string>
-#include <sstream>
-#include <map>
-#include <algorithm>
-#include <iterator>
 #include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <iomanip>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
 
-typedef std::map< std::string, int >    wordcount;
+// reads the solutions written by puzzle, either as text ( a line of words
+// per solution ) or as --format=jsonl, and counts how often each word turns
+// up at each position. words are interned so each position is a flat array
+// of counts indexed by word id rather than a map keyed by the word.
+//
+//   analyse [ n ] [ --consensus ] [ file ]
+//
+// by default prints the top n ( 5 ) words for each position. --consensus
+// instead works out which hint is most worth knowing the answer to, i.e.
+// the one whose word would cut the solutions down the most
+namespace
+{
+    class tally
+    {
+    public:
+        tally() : _solutions( 0 ), _skipped( 0 ) {}
 
-typedef std::map< int, wordcount > wordmap;
+        // one solution, each word as where it starts and how long it is
+        void add( std::vector< std::pair< char const *, std::size_t > > const & words )
+        {
+            // every solution of a puzzle has a word per hint, anything
+            // else is some other line that happens to look like words
+            if ( _positions.empty() )
+                _positions.resize( words.size() );
+            else if ( words.size() != _positions.size() )
+            {
+                ++_skipped;
+                return;
+            }
 
-int main( int c, char *v[] )
-{
-    wordmap wm;
-    std::size_t maxprint = 5;
+            for ( std::size_t i = 0 ; i < words.size() ; ++i )
+            {
+                auto id = intern( words[ i ].first, words[ i ].second );
+                auto & counts = _positions[ i ];
+
+                if ( counts.size() <= id )
+                    counts.resize( _names.size(), 0 );
+
+                ++counts[ id ];
+            }
+
+            ++_solutions;
+        }
+
+        std::size_t solutions() const { return _solutions; }
+        std::size_t skipped() const { return _skipped; }
+        std::size_t positions() const { return _positions.size(); }
+
+        std::string const & name( std::uint32_t id ) const { return _names[ id ]; }
+
+        // the n most common words at a position, most common first
+        std::vector< std::pair< std::uint64_t, std::uint32_t > > top( std::size_t position, std::size_t n ) const
+        {
+            auto const & counts = _positions[ position ];
+            std::vector< std::pair< std::uint64_t, std::uint32_t > > found;
+
+            for ( std::uint32_t id = 0 ; id < counts.size() ; ++id )
+            {
+                if ( counts[ id ] != 0 )
+                    found.emplace_back( counts[ id ], id );
+            }
+
+            // most common first, ties alphabetically
+            auto order = [ this ]( std::pair< std::uint64_t, std::uint32_t > const & a, std::pair< std::uint64_t, std::uint32_t > const & b )
+            {
+                return a.first != b.first ? a.first > b.first : _names[ a.second ] < _names[ b.second ];
+            };
 
-    if ( c > 1 )
+            n = std::min( n, found.size() );
+            std::partial_sort( found.begin(), found.begin() + n, found.end(), order );
+            found.resize( n );
+
+            return found;
+        }
+
+        struct spread
+        {
+            std::size_t words;      // different words seen at the position
+            double      entropy;    // bits of uncertainty left in the word
+            double      remaining;  // solutions expected to be left once the word is known
+        };
+
+        spread measure( std::size_t position ) const
+        {
+            spread s = { 0, 0, 0 };
+
+            for ( auto n : _positions[ position ] )
+            {
+                if ( n == 0 )
+                    continue;
+
+                double p = double( n ) / _solutions;
+
+                ++s.words;
+                s.entropy -= p * std::log2( p );
+
+                // the word is w with chance p, leaving n solutions
+                s.remaining += p * n;
+            }
+
+            return s;
+        }
+
+    private:
+        std::uint32_t intern( char const * word, std::size_t length )
+        {
+            _key.assign( word, length );
+
+            auto i = _ids.find( _key );
+            if ( i != _ids.end() )
+                return i->second;
+
+            auto id = static_cast< std::uint32_t >( _names.size() );
+            _names.push_back( _key );
+            _ids.emplace( _key, id );
+
+            return id;
+        }
+
+        std::unordered_map< std::string, std::uint32_t >    _ids;
+        std::vector< std::string >                          _names;
+        std::vector< std::vector< std::uint64_t > >         _positions;
+        std::string                                         _key;
+        std::size_t                                         _solutions;
+        std::size_t                                         _skipped;
+    };
+
+    typedef std::vector< std::pair< char const *, std::size_t > > wordlist;
+
+    // { "solution": [ "a", "b" ], ... }, false for any other json line
+    bool parseJson( std::string const & line, wordlist & words )
     {
-        maxprint = atoi( v[ 1 ] );
+        auto at = line.find( "\"solution\"" );
+        if ( at == std::string::npos )
+            return false;
+
+        auto open = line.find( '[', at );
+        auto close = line.find( ']', at );
+        if ( open == std::string::npos || close == std::string::npos )
+            return false;
+
+        for ( auto p = open ; ; )
+        {
+            auto first = line.find( '"', p + 1 );
+            if ( first == std::string::npos || first > close )
+                break;
+
+            auto last = line.find( '"', first + 1 );
+            if ( last == std::string::npos )
+                return false;
+
+            words.emplace_back( line.data() + first + 1, last - first - 1 );
+            p = last;
+        }
+
+        return !words.empty();
     }
 
-    for ( std::string line ; std::getline( std::cin, line ) ; )
+    // a solution is nothing but lower case words, which skips the counts
+    // and comments puzzle writes around them. a row of the grid is lower
+    // case too but it's all single letters, no solution is. letters past
+    // ascii are utf-8, a byte of one never looks like anything else
+    bool parseText( std::string const & line, wordlist & words )
     {
-        std::vector< std::string > words;
+        char const * p = line.data();
+        char const * end = p + line.size();
+        std::size_t longest = 0;
 
-        std::stringstream ss( line );
+        while ( p < end )
+        {
+            while ( p < end && ( *p == ' ' || *p == '\t' || *p == '\r' ) )
+                ++p;
 
-        std::copy( std::istream_iterator< std::string >( ss ), std::istream_iterator< std::string >(), std::back_inserter( words ) );
+            char const * start = p;
+            std::size_t letters = 0;
 
-        for ( std::size_t i = 0 ; i < words.size() ; ++i )
-        {
-            auto wmi = wm.find( i );
-            if ( wmi == wm.end() )
+            for ( ; p < end && ( ( *p >= 'a' && *p <= 'z' ) || ( *p & 0x80 ) != 0 ) ; ++p )
             {
-                auto iret = wm.insert( std::make_pair( i, wordmap::mapped_type{} ) );
-                wmi = iret.first;
+                // the bytes after the first of a utf-8 letter are 10xxxxxx
+                if ( ( *p & 0xc0 ) != 0x80 )
+                    ++letters;
             }
 
-            auto it = wmi->second.find( words[ i ] );
-            if ( it == wmi->second.end() )
+            if ( p < end && *p != ' ' && *p != '\t' && *p != '\r' )
+                return false;
+
+            if ( p > start )
             {
-                auto iret = wmi->second.insert( std::make_pair( words[ i ], 0 ) );
-                it = iret.first;
+                words.emplace_back( start, p - start );
+                longest = std::max( longest, letters );
             }
+        }
 
-            ++it->second;
+        return longest > 1;
+    }
+
+    void read( std::istream & in, tally & t )
+    {
+        std::string line;
+        wordlist words;
+
+        while ( std::getline( in, line ) )
+        {
+            words.clear();
+
+            auto first = line.find_first_not_of( " \t" );
+            if ( first == std::string::npos || line[ first ] == '#' )
+                continue;
+
+            bool ok = line[ first ] == '{' ? parseJson( line, words ) : parseText( line, words );
+
+            if ( ok )
+                t.add( words );
         }
     }
 
-    // ok, we have our word map. we need to print out the top 5
-    // words by count for each level
+    void top( tally const & t, std::size_t maxprint )
+    {
+        for ( std::size_t i = 0 ; i < t.positions() ; ++i )
+        {
+            std::cout << i + 1 << std::endl;
+
+            for ( auto const & w : t.top( i, maxprint ) )
+                std::cout << "    " << t.name( w.second ) << " " << w.first << std::endl;
+        }
+    }
 
-    for ( auto const & wcm : wm )
+    void consensus( tally const & t )
     {
-        std::cout << wcm.first + 1 << std::endl;
+        std::cout << t.solutions() << " solutions" << std::endl;
+        std::cout << "hint  words  entropy  expected left  most likely" << std::endl;
+
+        std::size_t best = t.positions();
+        double bestRemaining = 0;
+
+        for ( std::size_t i = 0 ; i < t.positions() ; ++i )
+        {
+            auto s = t.measure( i );
+            auto likely = t.top( i, 1 );
 
-        // ok need to sort wm by value rather than key
+            std::cout << std::fixed << std::setw( 4 ) << i + 1 << std::setw( 7 ) << s.words << std::setprecision( 2 ) << std::setw( 9 ) << s.entropy
+                << std::setprecision( 1 ) << std::setw( 15 ) << s.remaining << "  " << t.name( likely[ 0 ].second )
+                << " ( " << 100.0 * likely[ 0 ].first / t.solutions() << "% )" << std::endl;
 
-        std::multimap< int, std::string, std::greater< int > > sm;
+            // a hint with one word is settled already, there's nothing to learn from it
+            if ( s.words > 1 && ( best == t.positions() || s.remaining < bestRemaining ) )
+            {
+                best = i;
+                bestRemaining = s.remaining;
+            }
+        }
+
+        if ( best == t.positions() )
+            std::cout << "every hint has only the one word" << std::endl;
+        else
+            std::cout << "fix hint " << best + 1 << " next, knowing its word leaves " << std::setprecision( 1 ) << bestRemaining
+                << " of the " << t.solutions() << " solutions on average" << std::endl;
+    }
+}
+
+int main( int c, char *v[] )
+{
+    std::size_t maxprint = 5;
+    bool agree = false;
+    std::string file;
+
+    for ( int i = 1 ; i < c ; ++i )
+    {
+        std::string a( v[ i ] );
 
-        for ( auto const & wc : wcm.second )
+        if ( a == "--consensus" )
+            agree = true;
+        else if ( !a.empty() && std::isdigit( static_cast< unsigned char >( a[ 0 ] ) ) )
+            maxprint = std::strtoul( a.c_str(), nullptr, 10 );
+        else if ( a[ 0 ] != '-' || a == "-" )
+            file = a;
+        else
         {
-            sm.insert( std::make_pair( wc.second, wc.first ) );
+            std::cerr << "usage: " << v[ 0 ] << " [ n ] [ --consensus ] [ file|- ]" << std::endl;
+            return 1;
         }
+    }
+
+    std::ios::sync_with_stdio( false );
+
+    tally t;
 
-        std::size_t n = 0u;
-        for ( auto const & smi : sm )
+    if ( file.empty() || file == "-" )
+        read( std::cin, t );
+    else
+    {
+        std::ifstream in( file );
+
+        if ( !in )
         {
-            std::cout << "    " << smi.second << " " << smi.first << std::endl;
-            ++n;
-            if ( n >= maxprint )
-                break;
+            std::cerr << "unable to open \"" << file << "\"" << std::endl;
+            return 1;
         }
+
+        read( in, t );
+    }
+
+    if ( t.solutions() == 0 )
+    {
+        std::cerr << "no solutions found" << std::endl;
+        return 1;
     }
+
+    if ( agree )
+        consensus( t );
+    else
+        top( t, maxprint );
+
+    return 0;
 }
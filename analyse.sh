@@ -1,3 +1,3 @@
 #!/bin/bash
 
-tail -n +16 p.out | build/analyse $@
+build/analyse "$@" p.out
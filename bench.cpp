@@ -0,0 +1,1007 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <bitset>
+#include <tbb/tbb.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#endif
+
+#include "dictionary.hpp"
+#include "wordcache.hpp"
+#include "grid.hpp"
+#include "puzzle.hpp"
+#include "puzzledef.hpp"
+
+// once these are inlined gcc sees free() given memory from operator new
+// and can't tell it's our own operator new that malloc'd it
+#if defined( __GNUC__ ) && !defined( __clang__ ) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// count every trip to the heap so we can see what the search costs in allocations
+namespace
+{
+	std::atomic< std::size_t > allocations( 0 );
+}
+
+void * operator new( std::size_t n )
+{
+	++allocations;
+
+	void * p = std::malloc( n ? n : 1 );
+	if ( p == nullptr )
+		std::abort();
+	return p;
+}
+
+void * operator new[]( std::size_t n )
+{
+	return operator new( n );
+}
+
+void * operator new( std::size_t n, std::nothrow_t const & ) noexcept
+{
+	++allocations;
+	return std::malloc( n ? n : 1 );
+}
+
+void * operator new[]( std::size_t n, std::nothrow_t const & ) noexcept
+{
+	return operator new( n, std::nothrow );
+}
+
+void operator delete( void * p ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete[]( void * p ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete( void * p, std::size_t ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete[]( void * p, std::size_t ) noexcept
+{
+	std::free( p );
+}
+
+namespace
+{
+	void usage( char const * prog )
+	{
+		std::cerr << "usage: " << prog << " [ --dict words.txt|words.bin ] alloc height width letters hint [ hint ... ]" << std::endl;
+		std::cerr << "       " << prog << " [ --dict words.txt|words.bin ] corpus [ --max-cells n ] [ --limit n ] [ --csv file ] [ --json file ] [ --baseline file.csv ] path [ path ... ]" << std::endl;
+		std::cerr << "       " << prog << " remove [ --iterations n ] height width letters" << std::endl;
+		std::cerr << "       " << prog << " [ --dict words.txt|words.bin ] scaling [ --threads n,n,... ] height width letters hint [ hint ... ]" << std::endl;
+		std::cerr << "       " << prog << " [ --dict words.txt|words.bin ] crossover height width letters hint [ hint ... ]" << std::endl;
+		std::cerr << "  alloc  : count the heap allocations made while solving one puzzle" << std::endl;
+		std::cerr << "  remove : time taking words out of a grid against the column by column bubbling it used to do" << std::endl;
+		std::cerr << "  scaling: solve one puzzle with more and more threads, by default 1, 2, 4 .. up to the number of cores" << std::endl;
+		std::cerr << "  crossover: solve one puzzle cell by cell and word by word as its hints are given more and more of the answer" << std::endl;
+		std::cerr << "  corpus : solve every \"puzzle\" line in the given files or directories ( e.g. wb1.solutions )" << std::endl;
+		std::cerr << "           and check the \"# solution\" line after it is found" << std::endl;
+		exit( 1 );
+	}
+
+	template< std::size_t Bits, std::size_t Letters >
+	int alloc( puzzledef const & def, wordcache const & words )
+	{
+		std::ostream null( nullptr );
+
+		puzzle< Bits, Letters > p( words, searchoptions(), null );
+		grid< Bits, Letters > letters( def.height, def.width, def.letters );
+
+		// warm up the thread pool so its start up isn't counted against the search
+		tbb::parallel_for< std::size_t >( 0, 1024, []( std::size_t ) {} );
+
+		auto before = allocations.load();
+		auto start = std::chrono::steady_clock::now();
+
+		p.search( letters, def.hints );
+
+		auto elapsed = std::chrono::duration_cast< std::chrono::milliseconds >( std::chrono::steady_clock::now() - start ).count();
+		auto count = allocations.load() - before;
+		auto solutions = p.solutions().size();
+
+		std::cout << "time        : " << elapsed << "ms" << std::endl;
+		std::cout << "solutions   : " << solutions << std::endl;
+		std::cout << "allocations : " << count << std::endl;
+		if ( solutions > 0 )
+			std::cout << "per solution: " << double( count ) / solutions << std::endl;
+
+		return 0;
+	}
+
+	int alloc( dictionary const & dict, std::vector< std::string > const & args )
+	{
+		puzzledef def;
+		std::string error;
+
+		if ( !parsePuzzle( args, dict.symbols(), def, error ) )
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+
+		std::ostream null( nullptr );
+
+		wordcache words( dict, def.hints, def.letters, null );
+
+		return withBits( def.height * def.width, words.symbols().size(), [ & ]( auto bits, auto letters ) { return alloc< bits, letters >( def, words ); } );
+	}
+
+	template< std::size_t Bits, std::size_t Letters >
+	double solveMs( puzzledef const & def, wordcache const & words, std::vector< std::string > & solutions, searchoptions const & options = searchoptions() )
+	{
+		std::ostream null( nullptr );
+
+		puzzle< Bits, Letters > p( words, options, null );
+		grid< Bits, Letters > letters( def.height, def.width, def.letters );
+
+		auto start = std::chrono::steady_clock::now();
+
+		p.search( letters, def.hints );
+
+		solutions = p.solutions();
+
+		return std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - start ).count();
+	}
+
+	int scaling( dictionary const & dict, std::vector< std::string > args )
+	{
+		std::vector< std::size_t > threads;
+
+		if ( args.size() > 1 && args[ 0 ] == "--threads" )
+		{
+			std::istringstream ss( args[ 1 ] );
+			std::string n;
+
+			while ( std::getline( ss, n, ',' ) )
+				threads.push_back( std::strtoul( n.c_str(), nullptr, 10 ) );
+
+			args.erase( args.begin(), args.begin() + 2 );
+		}
+		else
+		{
+			std::size_t cores = tbb::info::default_concurrency();
+
+			for ( std::size_t n = 1 ; n < cores ; n *= 2 )
+				threads.push_back( n );
+			threads.push_back( cores );
+		}
+
+		puzzledef def;
+		std::string error;
+
+		if ( !parsePuzzle( args, dict.symbols(), def, error ) )
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+
+		std::ostream null( nullptr );
+
+		wordcache words( dict, def.hints, def.letters, null );
+
+		double single = 0;
+
+		std::cout << "threads       ms  speedup  efficiency  solutions" << std::endl;
+
+		for ( auto n : threads )
+		{
+			tbb::global_control limit( tbb::global_control::max_allowed_parallelism, n );
+
+			// warm up the threads we're allowed so their start up isn't counted
+			tbb::parallel_for< std::size_t >( 0, 1024, []( std::size_t ) {} );
+
+			std::vector< std::string > solutions;
+			double ms = withBits( def.height * def.width, words.symbols().size(), [ & ]( auto bits, auto letters ) { return solveMs< bits, letters >( def, words, solutions ); } );
+
+			if ( single == 0 )
+				single = ms * threads.front();
+
+			double speedup = single / ms;
+
+			std::cout << std::fixed << std::setw( 7 ) << n << std::setprecision( 1 ) << std::setw( 9 ) << ms << std::setprecision( 2 ) << std::setw( 9 ) << speedup
+				<< std::setprecision( 0 ) << std::setw( 11 ) << 100.0 * speedup / n << "%" << std::setw( 11 ) << solutions.size() << std::endl;
+		}
+
+		return 0;
+	}
+
+	double solveMs( puzzledef const & def, wordcache const & words, std::vector< std::string > & solutions, searchoptions const & options )
+	{
+		return withBits( def.height * def.width, words.symbols().size(), [ & ]( auto bits, auto letters ) { return solveMs< bits, letters >( def, words, solutions, options ); } );
+	}
+
+	template< std::size_t Bits, std::size_t Letters >
+	std::string firstSolution( puzzledef const & def, wordcache const & words )
+	{
+		std::ostream null( nullptr );
+
+		searchoptions options;
+		options.maxSolutions = 1;
+
+		puzzle< Bits, Letters > p( words, options, null );
+		p.search( grid< Bits, Letters >( def.height, def.width, def.letters ), def.hints );
+
+		return p.solutions().empty() ? std::string() : *p.solutions().begin();
+	}
+
+	// find where looking for each word in the grid starts to beat spreading
+	// out from the cells. the puzzle is solved once, then solved again with
+	// every hint given more and more of its answer, which cuts down the
+	// words a hint could be until there's only the one
+	int crossover( dictionary const & dict, std::vector< std::string > const & args )
+	{
+		puzzledef def;
+		std::string error;
+
+		if ( !parsePuzzle( args, dict.symbols(), def, error ) )
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+
+		std::ostream null( nullptr );
+		std::string answer;
+
+		{
+			wordcache words( dict, def.hints, def.letters, null );
+
+			answer = withBits( def.height * def.width, words.symbols().size(), [ & ]( auto bits, auto letters ) { return firstSolution< bits, letters >( def, words ); } );
+		}
+
+		std::vector< std::string > solution;
+		{
+			std::istringstream ss( answer );
+			std::string w;
+			while ( ss >> w )
+				solution.push_back( w );
+		}
+
+		if ( solution.size() != def.hints.size() )
+		{
+			std::cerr << "the puzzle has no solution" << std::endl;
+			return 1;
+		}
+
+		std::size_t longest = 0;
+		for ( auto const & w : solution )
+			longest = std::max( longest, w.size() );
+
+		// warm up the thread pool so its start up isn't counted against the first solve
+		tbb::parallel_for< std::size_t >( 0, 1024, []( std::size_t ) {} );
+
+		bool agreed = true;
+
+		std::cout << "given  candidates  tree nodes   cells ms   words ms    auto ms  solutions" << std::endl;
+
+		for ( std::size_t given = 0 ; given <= longest ; ++given )
+		{
+			puzzledef d( def );
+
+			for ( std::size_t i = 0 ; i < d.hints.size() ; ++i )
+			{
+				auto & h = d.hints[ i ];
+				auto const & w = solution[ i ];
+
+				// never take away letters the hint gave already
+				if ( std::get< 1 >( h ).size() >= std::min( given, w.size() ) )
+					continue;
+
+				if ( given >= w.size() )
+				{
+					std::string reversed( w.rbegin(), w.rend() );
+					h = wordhint( w.size(), w, reversed );
+				}
+				else
+					h = wordhint( w.size(), w.substr( 0, given ), "" );
+			}
+
+			wordcache words( dict, d.hints, d.letters, null );
+
+			std::size_t candidates = 0, nodes = 0;
+			for ( std::size_t i = 0 ; i < d.hints.size() ; ++i )
+			{
+				candidates += words.candidates( i ).size();
+				nodes += words.trie( i ).size();
+			}
+
+			double ms[ 3 ];
+			std::vector< std::string > solutions[ 3 ];
+			strategy methods[ 3 ] = { strategy::cells, strategy::words, strategy::automatic };
+
+			for ( std::size_t m = 0 ; m < 3 ; ++m )
+			{
+				searchoptions options;
+				options.method = methods[ m ];
+				ms[ m ] = solveMs( d, words, solutions[ m ], options );
+			}
+
+			std::cout << std::fixed << std::setw( 5 ) << given << std::setw( 12 ) << candidates << std::setw( 12 ) << nodes << std::setprecision( 1 )
+				<< std::setw( 11 ) << ms[ 0 ] << std::setw( 11 ) << ms[ 1 ] << std::setw( 11 ) << ms[ 2 ] << std::setw( 11 ) << solutions[ 0 ].size()
+				<< ( ms[ 1 ] < ms[ 0 ] ? "  words" : "  cells" ) << std::endl;
+
+			// however a hint's words are found, the solutions must be the same
+			if ( solutions[ 1 ] != solutions[ 0 ] || solutions[ 2 ] != solutions[ 0 ] )
+			{
+				std::cout << "MISMATCH given " << given << ": cells found " << solutions[ 0 ].size() << " solutions, words " << solutions[ 1 ].size()
+					<< ", auto " << solutions[ 2 ].size() << std::endl;
+				agreed = false;
+			}
+		}
+
+		return agreed ? 0 : 1;
+	}
+
+	// how grid::remove used to do it, bubbling letters down each column it
+	// touched until nothing moved and then rebuilding the masks for the
+	// whole grid. kept here to measure the new one against
+	template< std::size_t Bits >
+	struct legacygrid
+	{
+		std::array< char, Bits >	l;
+		wordpath< Bits >					occupied;
+		std::array< wordpath< Bits >, 26 >	cells;
+	};
+
+	template< std::size_t Bits >
+	void legacyRemove( std::size_t h, std::size_t w, std::array< char, Bits > const & l, wordpath< Bits > const & removed, legacygrid< Bits > & out )
+	{
+		std::size_t s = h * w;
+		std::bitset< Bits > col_modified;
+
+		out.l = l;
+
+		for ( std::size_t p = 0 ; p < s ; ++p )
+		{
+			if ( removed.test( p ) )
+			{
+				out.l[ p ] = ' ';
+				col_modified.set( p % w );
+			}
+		}
+
+		bool modified;
+
+		for ( std::size_t c = 0 ; c < w ; ++c )
+		{
+			if ( !col_modified.test( c ) )
+				continue;
+
+			do {
+				modified = false;
+
+				for ( std::size_t pos = c + w ; pos < s ; pos += w )
+				{
+					char * lower = &out.l[ pos ];
+					char * upper = lower - w;
+
+					if ( *lower == ' ' && *upper != ' ' )
+					{
+						std::swap( *upper, *lower );
+						modified = true;
+					}
+				}
+			} while ( modified );
+		}
+
+		out.occupied.reset();
+		for ( auto & m : out.cells )
+			m.reset();
+
+		for ( std::size_t p = 0 ; p < s ; ++p )
+		{
+			char c = out.l[ p ];
+			if ( c >= 'a' && c <= 'z' )
+			{
+				out.occupied.set( p );
+				out.cells[ c - 'a' ].set( p );
+			}
+		}
+	}
+
+	template< std::size_t Bits, std::size_t Letters >
+	int remove( puzzledef const & def, std::size_t iterations )
+	{
+		// take random words out of the grid until it's empty, over and over,
+		// to get a spread of grids and paths to time
+		std::vector< grid< Bits, Letters > > grids;
+		std::vector< wordpath< Bits > > paths;
+		std::uint64_t seed = 88172645463325252ULL;
+
+		auto random = [ &seed ]()
+		{
+			seed ^= seed << 13;
+			seed ^= seed >> 7;
+			seed ^= seed << 17;
+			return seed;
+		};
+
+		while ( grids.size() < 4096 )
+		{
+			grid< Bits, Letters > g( def.height, def.width, def.letters );
+
+			while ( !g.empty() )
+			{
+				wordpath< Bits > p;
+				std::size_t length = 3 + random() % 6;
+
+				auto cells = g.occupied();
+				std::size_t n = cells.count();
+				std::size_t pos = 0;
+
+				for ( std::size_t skip = random() % n ; ; cells.reset( pos ) )
+				{
+					pos = cells.lowest();
+					if ( skip-- == 0 )
+						break;
+				}
+
+				for ( std::size_t i = 0 ; i < length ; ++i )
+				{
+					p.set( pos );
+
+					auto next = g.neighbours( pos ) & g.occupied() & ~p;
+					if ( next.none() )
+						break;
+
+					for ( std::size_t skip = random() % next.count() ; skip > 0 ; --skip )
+						next.reset( next.lowest() );
+					pos = next.lowest();
+				}
+
+				grids.push_back( g );
+				paths.push_back( p );
+
+				g = g.remove( p );
+			}
+		}
+
+		// both have to leave the same letters behind, and the masks patched
+		// as they fall have to be the ones the legacy algorithm builds from
+		// scratch. it doesn't know about wildcards, those are in the cells
+		// of every letter
+		for ( std::size_t i = 0 ; i < grids.size() ; ++i )
+		{
+			legacygrid< Bits > old;
+			legacyRemove< Bits >( def.height, def.width, grids[ i ].letters(), paths[ i ], old );
+
+			auto now = grids[ i ].remove( paths[ i ] );
+
+			wordpath< Bits > wild;
+			for ( std::size_t p = 0 ; p < def.height * def.width ; ++p )
+			{
+				if ( grid< Bits, Letters >::isWild( old.l[ p ] ) )
+					wild.set( p );
+			}
+
+			bool same = old.l == now.letters() && ( old.occupied | wild ) == now.occupied() && wild == now.wild();
+
+			for ( std::size_t c = 0 ; c < old.cells.size() ; ++c )
+				same = same && ( old.cells[ c ] | wild ) == now.cells( letterAt( c ) );
+
+			if ( !same )
+			{
+				std::cerr << "grid::remove disagrees with the legacy algorithm on grid " << i << std::endl;
+				return 1;
+			}
+		}
+
+		std::size_t check = 0;
+
+		auto start = std::chrono::steady_clock::now();
+
+		for ( std::size_t n = 0 ; n < iterations ; ++n )
+		{
+			for ( std::size_t i = 0 ; i < grids.size() ; ++i )
+			{
+				legacygrid< Bits > old;
+				legacyRemove< Bits >( def.height, def.width, grids[ i ].letters(), paths[ i ], old );
+				check += old.occupied.count();
+			}
+		}
+
+		auto middle = std::chrono::steady_clock::now();
+
+		for ( std::size_t n = 0 ; n < iterations ; ++n )
+		{
+			for ( std::size_t i = 0 ; i < grids.size() ; ++i )
+				check += grids[ i ].remove( paths[ i ] ).occupied().count();
+		}
+
+		auto end = std::chrono::steady_clock::now();
+
+		double calls = double( iterations ) * grids.size();
+		double legacy = std::chrono::duration< double, std::nano >( middle - start ).count() / calls;
+		double now = std::chrono::duration< double, std::nano >( end - middle ).count() / calls;
+
+		std::cout << grids.size() << " grids and paths, " << iterations << " iterations ( check " << check << " )" << std::endl;
+		std::cout << "legacy : " << legacy << "ns per remove" << std::endl;
+		std::cout << "remove : " << now << "ns per remove ( " << legacy / now << "x )" << std::endl;
+
+		return 0;
+	}
+
+	int remove( std::vector< std::string > args )
+	{
+		std::size_t iterations = 100;
+
+		if ( args.size() > 1 && args[ 0 ] == "--iterations" )
+		{
+			iterations = std::strtoul( args[ 1 ].c_str(), nullptr, 10 );
+			args.erase( args.begin(), args.begin() + 2 );
+		}
+
+		// the hints don't matter here but parsePuzzle wants them
+		if ( args.size() == 3 )
+			args.push_back( std::to_string( alphabet::length( args[ 2 ] ) ) );
+
+		puzzledef def;
+		std::string error;
+
+		// there's no word list, the letters are a-z
+		if ( !parsePuzzle( args, alphabet(), def, error ) )
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+
+		return withBits( def.height * def.width, ENGLISH_LETTERS, [ & ]( auto bits, auto letters ) { return remove< bits, letters >( def, iterations ); } );
+	}
+
+	// a puzzle from the corpus and the solution recorded for it
+	struct corpuscase
+	{
+		std::string		key;		// file:line
+		std::string		line;
+		std::string		expected;	// words separated and ended by a space, as puzzle reports them
+	};
+
+	struct corpusresult
+	{
+		std::string		key;
+		std::size_t		cells;
+		double			cacheMs;
+		double			searchMs;
+		std::size_t		nodes;
+		std::size_t		placed;
+		std::size_t		solutions;
+		long			peakKb;
+		bool			found;
+		std::string		error;
+	};
+
+	// the most memory the process has had resident
+	long peakKb() throw()
+	{
+#ifndef _WIN32
+		struct rusage ru;
+		if ( ::getrusage( RUSAGE_SELF, &ru ) == 0 )
+			return ru.ru_maxrss;
+#endif
+		return 0;
+	}
+
+	// linux lets the high water mark be reset, so each puzzle can have a
+	// peak of its own. elsewhere this does nothing and puzzlePeakKb() is
+	// the process's peak so far
+	void resetPeak() throw()
+	{
+#ifdef __linux__
+		std::ofstream f( "/proc/self/clear_refs" );
+		f << "5";
+#endif
+	}
+
+	long puzzlePeakKb() throw()
+	{
+#ifdef __linux__
+		std::ifstream f( "/proc/self/status" );
+		std::string line;
+
+		while ( std::getline( f, line ) )
+		{
+			if ( line.compare( 0, 6, "VmHWM:" ) == 0 )
+				return std::strtol( line.c_str() + 6, nullptr, 10 );
+		}
+#endif
+		return peakKb();
+	}
+
+	void listFiles( std::string const & path, std::vector< std::string > & files ) throw()
+	{
+#ifndef _WIN32
+		struct stat st;
+
+		if ( ::stat( path.c_str(), &st ) == 0 && S_ISDIR( st.st_mode ) )
+		{
+			std::vector< std::string > entries;
+
+			if ( DIR * d = ::opendir( path.c_str() ) )
+			{
+				while ( struct dirent * e = ::readdir( d ) )
+				{
+					if ( e->d_name[ 0 ] != '.' )
+						entries.push_back( path + "/" + e->d_name );
+				}
+				::closedir( d );
+			}
+
+			// so the report comes out in the same order every run
+			std::sort( entries.begin(), entries.end() );
+
+			for ( auto const & e : entries )
+				listFiles( e, files );
+			return;
+		}
+#endif
+		files.push_back( path );
+	}
+
+	void readCorpus( std::string const & file, std::vector< corpuscase > & cases ) throw()
+	{
+		std::fstream f( file, std::ios::in );
+		std::string line;
+		std::size_t n = 0;
+		corpuscase * last = nullptr;
+
+		while ( std::getline( f, line ) )
+		{
+			++n;
+
+			std::istringstream ss( line );
+			std::string first;
+			ss >> first;
+
+			if ( first == "puzzle" )
+			{
+				corpuscase c;
+				c.key = file + ":" + std::to_string( n );
+				c.line = line;
+				cases.push_back( c );
+				last = &cases.back();
+			}
+			else if ( first == "#" && last != nullptr )
+			{
+				// wb1 writes "# solution word ...", wb2 just "# word ..."
+				std::string word;
+
+				while ( ss >> word )
+				{
+					if ( word != "solution" || !last->expected.empty() )
+						last->expected += word + " ";
+				}
+
+				last = nullptr;
+			}
+		}
+	}
+
+	template< std::size_t Bits, std::size_t Letters >
+	void solve( puzzledef const & def, wordcache const & words, std::string const & expected, corpusresult & r )
+	{
+		std::ostream null( nullptr );
+
+		puzzle< Bits, Letters > p( words, searchoptions(), null );
+		grid< Bits, Letters > letters( def.height, def.width, def.letters );
+
+		auto start = std::chrono::steady_clock::now();
+
+		p.search( letters, def.hints );
+
+		r.searchMs = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - start ).count();
+		r.nodes = p.nodesExpanded();
+		r.placed = p.wordsPlaced();
+		r.solutions = p.solutions().size();
+		r.found = std::binary_search( p.solutions().begin(), p.solutions().end(), expected );
+	}
+
+	corpusresult solve( dictionary const & dict, corpuscase const & c )
+	{
+		corpusresult r;
+		r.key = c.key;
+		r.cells = 0;
+		r.cacheMs = r.searchMs = 0;
+		r.nodes = r.placed = r.solutions = 0;
+		r.found = false;
+
+		resetPeak();
+
+		auto args = splitPuzzleLine( c.line );
+		args.erase( args.begin() );
+
+		puzzledef def;
+
+		if ( !parsePuzzle( args, dict.symbols(), def, r.error ) )
+		{
+			r.peakKb = puzzlePeakKb();
+			return r;
+		}
+
+		r.cells = def.height * def.width;
+
+		std::ostream null( nullptr );
+
+		auto start = std::chrono::steady_clock::now();
+
+		wordcache words( dict, def.hints, def.letters, null );
+
+		r.cacheMs = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - start ).count();
+
+		// the solutions are letters of the word list's alphabet
+		std::string expected;
+		dict.symbols().encode( c.expected, expected );
+
+		withBits( r.cells, words.symbols().size(), [ & ]( auto bits, auto letters ) { solve< bits, letters >( def, words, expected, r ); } );
+
+		r.peakKb = puzzlePeakKb();
+
+		if ( c.expected.empty() )
+			r.error = "no solution recorded";
+
+		return r;
+	}
+
+	void writeCsv( std::ostream & out, std::vector< corpusresult > const & results )
+	{
+		out << "puzzle,cells,cache_ms,search_ms,nodes,words,solutions,peak_kb,found" << std::endl;
+
+		for ( auto const & r : results )
+			out << r.key << "," << r.cells << "," << r.cacheMs << "," << r.searchMs << "," << r.nodes << "," << r.placed << "," << r.solutions << "," << r.peakKb << "," << ( r.found ? 1 : 0 ) << std::endl;
+	}
+
+	void writeJson( std::ostream & out, std::vector< corpusresult > const & results )
+	{
+		out << "[" << std::endl;
+
+		for ( std::size_t i = 0 ; i < results.size() ; ++i )
+		{
+			auto const & r = results[ i ];
+
+			out << "  { \"puzzle\": \"" << r.key << "\", \"cells\": " << r.cells << ", \"cache_ms\": " << r.cacheMs << ", \"search_ms\": " << r.searchMs
+				<< ", \"nodes\": " << r.nodes << ", \"words\": " << r.placed << ", \"solutions\": " << r.solutions << ", \"peak_kb\": " << r.peakKb
+				<< ", \"found\": " << ( r.found ? "true" : "false" );
+
+			if ( !r.error.empty() )
+				out << ", \"error\": \"" << r.error << "\"";
+
+			out << " }" << ( i + 1 < results.size() ? "," : "" ) << std::endl;
+		}
+
+		out << "]" << std::endl;
+	}
+
+	// compare against a csv written by an earlier run. node and word counts
+	// should only change when the search changes, times are allowed some noise
+	int compare( std::string const & file, std::vector< corpusresult > const & results )
+	{
+		std::fstream f( file, std::ios::in );
+
+		if ( !f )
+		{
+			std::cerr << "unable to open baseline \"" << file << "\"" << std::endl;
+			return 1;
+		}
+
+		std::map< std::string, corpusresult > baseline;
+		std::string line;
+
+		std::getline( f, line );	// header
+
+		while ( std::getline( f, line ) )
+		{
+			std::replace( line.begin(), line.end(), ',', ' ' );
+			std::istringstream ss( line );
+
+			corpusresult r;
+			int found = 0;
+
+			if ( ss >> r.key >> r.cells >> r.cacheMs >> r.searchMs >> r.nodes >> r.placed >> r.solutions >> r.peakKb >> found )
+			{
+				r.found = found != 0;
+				baseline[ r.key ] = r;
+			}
+		}
+
+		double before = 0, after = 0;
+		std::size_t compared = 0, slower = 0, changed = 0, lost = 0;
+
+		for ( auto const & r : results )
+		{
+			auto i = baseline.find( r.key );
+			if ( i == baseline.end() )
+				continue;
+
+			auto const & b = i->second;
+			double was = b.cacheMs + b.searchMs;
+			double now = r.cacheMs + r.searchMs;
+
+			++compared;
+			before += was;
+			after += now;
+
+			if ( b.found && !r.found )
+			{
+				++lost;
+				std::cout << "LOST     " << r.key << " the expected solution is no longer found" << std::endl;
+			}
+
+			if ( b.nodes != r.nodes || b.placed != r.placed )
+			{
+				++changed;
+				std::cout << "CHANGED  " << r.key << " nodes " << b.nodes << " -> " << r.nodes << ", words " << b.placed << " -> " << r.placed << std::endl;
+			}
+
+			// ignore the very quick ones, their times are mostly noise
+			if ( now > was * 1.1 && now - was > 5 )
+			{
+				++slower;
+				std::cout << "SLOWER   " << r.key << " " << was << "ms -> " << now << "ms" << std::endl;
+			}
+		}
+
+		std::cout << compared << " puzzles compared with " << file << ": " << before << "ms -> " << after << "ms";
+		if ( before > 0 )
+			std::cout << " ( " << 100.0 * after / before << "% )";
+		std::cout << ", " << slower << " slower, " << changed << " with changed counts, " << lost << " lost solutions" << std::endl;
+
+		return lost == 0 ? 0 : 1;
+	}
+
+	int corpus( dictionary const & dict, std::vector< std::string > const & args )
+	{
+		std::size_t maxCells = MAX_BITS;
+		std::size_t limit = 0;
+		std::string csv, json, baseline;
+		std::vector< std::string > files;
+
+		for ( std::size_t i = 0 ; i < args.size() ; ++i )
+		{
+			if ( args[ i ] == "--max-cells" && i + 1 < args.size() )
+				maxCells = std::strtoul( args[ ++i ].c_str(), nullptr, 10 );
+			else if ( args[ i ] == "--limit" && i + 1 < args.size() )
+				limit = std::strtoul( args[ ++i ].c_str(), nullptr, 10 );
+			else if ( args[ i ] == "--csv" && i + 1 < args.size() )
+				csv = args[ ++i ];
+			else if ( args[ i ] == "--json" && i + 1 < args.size() )
+				json = args[ ++i ];
+			else if ( args[ i ] == "--baseline" && i + 1 < args.size() )
+				baseline = args[ ++i ];
+			else
+				listFiles( args[ i ], files );
+		}
+
+		if ( files.empty() )
+		{
+			std::cerr << "no corpus files given" << std::endl;
+			return 1;
+		}
+
+		std::vector< corpuscase > cases;
+
+		for ( auto const & f : files )
+			readCorpus( f, cases );
+
+		// warm up the thread pool so its start up isn't counted against the first puzzle
+		tbb::parallel_for< std::size_t >( 0, 1024, []( std::size_t ) {} );
+
+		std::vector< corpusresult > results;
+		std::size_t missed = 0;
+
+		for ( auto const & c : cases )
+		{
+			if ( limit != 0 && results.size() >= limit )
+				break;
+
+			auto args = splitPuzzleLine( c.line );
+			if ( args.size() >= 4 && std::size_t( std::atoi( args[ 1 ].c_str() ) * std::atoi( args[ 2 ].c_str() ) ) > maxCells )
+				continue;
+
+			results.push_back( solve( dict, c ) );
+
+			auto const & r = results.back();
+
+			if ( !r.found )
+				++missed;
+
+			std::cout << r.key << " " << r.cacheMs + r.searchMs << "ms " << r.nodes << " nodes " << r.placed << " words " << r.solutions << " solutions"
+				<< ( r.found ? "" : " EXPECTED SOLUTION NOT FOUND" ) << ( r.error.empty() ? "" : " ( " + r.error + " )" ) << std::endl;
+		}
+
+		// resetting each puzzle's peak resets the process's too, so the
+		// run's peak is the biggest of the puzzles'
+		double total = 0;
+		long peak = 0;
+		for ( auto const & r : results )
+		{
+			total += r.cacheMs + r.searchMs;
+			peak = std::max( peak, r.peakKb );
+		}
+
+		std::cout << results.size() << " puzzles in " << total << "ms, " << missed << " without the expected solution, peak rss " << peak << "kb" << std::endl;
+
+		if ( !csv.empty() )
+		{
+			std::fstream f( csv, std::ios::out | std::ios::trunc );
+			writeCsv( f, results );
+		}
+
+		if ( !json.empty() )
+		{
+			std::fstream f( json, std::ios::out | std::ios::trunc );
+			writeJson( f, results );
+		}
+
+		if ( !baseline.empty() )
+			return compare( baseline, results );
+
+		return 0;
+	}
+}
+
+int main( int c, char *v[] )
+{
+	std::string dictfile( "words.txt" );
+	std::vector< std::string > args;
+
+	for ( auto i = 1 ; i < c ; ++i )
+	{
+		std::string a( v[ i ] );
+		if ( a == "--dict" && i + 1 < c )
+			dictfile = v[ ++i ];
+		else
+			args.push_back( a );
+	}
+
+	if ( args.empty() )
+		usage( v[ 0 ] );
+
+	std::string mode( args[ 0 ] );
+	args.erase( args.begin() );
+
+	// the only mode that doesn't need the words
+	if ( mode == "remove" )
+		return remove( args );
+
+	dictionary dict( dictfile );
+
+	if ( !dict.good() )
+	{
+		std::cerr << v[ 0 ] << ": unable to load dictionary \"" << dictfile << "\"" << std::endl;
+		return 1;
+	}
+
+	if ( mode == "alloc" )
+		return alloc( dict, args );
+
+	if ( mode == "corpus" )
+		return corpus( dict, args );
+
+	if ( mode == "scaling" )
+		return scaling( dict, args );
+
+	if ( mode == "crossover" )
+		return crossover( dict, args );
+
+	usage( v[ 0 ] );
+}
@@ -0,0 +1,508 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "dictionary.hpp"
+
+namespace
+{
+	char const			magic[ 8 ] = { 'P', 'Z', 'L', 'D', 'I', 'C', 'T', 0 };
+	std::uint32_t const	version = 3;
+
+	bool isMagic( char const * p ) throw()
+	{
+		return std::memcmp( p, magic, sizeof( magic ) ) == 0;
+	}
+
+	// a word per line, or any whitespace between them. a number after a
+	// word is how common it is, lists without them are all equally common
+	bool readText( std::string const & file, std::vector< std::pair< std::string, std::uint32_t > > & words ) throw()
+	{
+		std::fstream f( file, std::ios::in );
+
+		if ( !f )
+			return false;
+
+		std::string word;
+		std::string folded;
+		bool skipped = false;	// the last word wasn't kept, nor is its number
+
+		while( f >> word )
+		{
+			if ( word.find_first_not_of( "0123456789" ) == std::string::npos )
+			{
+				if ( !skipped && !words.empty() )
+					words.back().second = static_cast< std::uint32_t >( std::min< unsigned long long >( std::strtoull( word.c_str(), nullptr, 10 ), UINT32_MAX ) );
+
+				continue;
+			}
+
+			// we can only index letters, not "don't" or "x-ray"
+			skipped = !alphabet::fold( word, folded );
+
+			if ( skipped )
+				continue;
+
+			words.emplace_back( folded, 0 );
+		}
+
+		return true;
+	}
+}
+
+dictionary::dictionary( std::string const & file ) :
+	_map( nullptr ),
+	_mapSize( 0 ),
+	_header( nullptr ),
+	_letters( nullptr ),
+	_lengths( nullptr ),
+	_offsets( nullptr ),
+	_frequencies( nullptr ),
+	_text( nullptr ),
+	_fingerprint( 0 )
+{
+	char probe[ sizeof( magic ) ] = { 0 };
+
+	{
+		std::fstream f( file, std::ios::in | std::ios::binary );
+
+		if ( !f )
+			return;
+
+		f.read( probe, sizeof( probe ) );
+	}
+
+	if ( isMagic( probe ) )
+	{
+#ifndef _WIN32
+		int fd = ::open( file.c_str(), O_RDONLY );
+
+		if ( fd < 0 )
+			return;
+
+		struct stat st;
+
+		if ( ::fstat( fd, &st ) == 0 && st.st_size > 0 )
+		{
+			void * p = ::mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+			if ( p != MAP_FAILED )
+			{
+				_map = p;
+				_mapSize = st.st_size;
+			}
+		}
+
+		::close( fd );
+
+		if ( _map != nullptr )
+			attach( static_cast< char const * >( _map ), _mapSize );
+#else
+		std::fstream f( file, std::ios::in | std::ios::binary );
+
+		f.seekg( 0, std::ios::end );
+		_buffer.resize( static_cast< std::size_t >( f.tellg() ) );
+		f.seekg( 0, std::ios::beg );
+		f.read( _buffer.data(), _buffer.size() );
+
+		attach( _buffer.data(), _buffer.size() );
+#endif
+	}
+	else
+	{
+		std::vector< std::pair< std::string, std::uint32_t > > words;
+
+		if ( readText( file, words ) && build( words, _buffer ) )
+			attach( _buffer.data(), _buffer.size() );
+	}
+}
+
+dictionary::~dictionary()
+{
+#ifndef _WIN32
+	if ( _map != nullptr )
+		::munmap( _map, _mapSize );
+#endif
+}
+
+bool dictionary::compile( std::string const & in, std::string const & out ) throw()
+{
+	std::vector< std::pair< std::string, std::uint32_t > > words;
+	std::vector< char > image;
+
+	if ( !readText( in, words ) || !build( words, image ) )
+		return false;
+
+	std::fstream f( out, std::ios::out | std::ios::binary | std::ios::trunc );
+
+	if ( !f )
+		return false;
+
+	f.write( image.data(), image.size() );
+
+	header const * h = reinterpret_cast< header const * >( image.data() );
+
+	std::cout << "compiled " << words.size() << " words";
+	if ( h->_letters > 26 )
+		std::cout << " of " << h->_letters << " letters";
+	std::cout << ( h->_ranked ? " and their frequencies" : "" ) << " into " << image.size() << " bytes" << std::endl;
+
+	return static_cast< bool >( f );
+}
+
+bool dictionary::build( std::vector< std::pair< std::string, std::uint32_t > > & words, std::vector< char > & image ) throw()
+{
+	typedef std::pair< std::string, std::uint32_t > entry;
+
+	// a-z and as many of the other letters as there's room for, the ones
+	// the most words use. a word using a letter that didn't make it is left
+	// out, as a word with a hyphen in it is
+	std::map< std::uint32_t, std::size_t > used;
+	std::vector< std::uint32_t > seen;
+
+	for ( auto const & w : words )
+	{
+		char const * p = w.first.data();
+		char const * end = p + w.first.size();
+		std::uint32_t code;
+
+		seen.clear();
+
+		while ( alphabet::next( p, end, code ) )
+		{
+			if ( code > 'z' && std::find( seen.begin(), seen.end(), code ) == seen.end() )
+			{
+				seen.push_back( code );
+				++used[ code ];
+			}
+		}
+	}
+
+	std::vector< std::pair< std::size_t, std::uint32_t > > byUse;
+
+	for ( auto const & u : used )
+		byUse.emplace_back( u.second, u.first );
+
+	std::stable_sort( byUse.begin(), byUse.end(), []( std::pair< std::size_t, std::uint32_t > const & a, std::pair< std::size_t, std::uint32_t > const & b ) { return a.first > b.first; } );
+
+	std::vector< std::uint32_t > more;
+
+	for ( std::size_t i = 0 ; i < byUse.size() && i < MAX_LETTERS - 26 ; ++i )
+		more.push_back( byUse[ i ].second );
+
+	std::sort( more.begin(), more.end() );
+
+	alphabet letters( more );
+
+	// from here on a word is its letters
+	std::size_t encoded = 0;
+	std::string symbols;
+
+	for ( auto & w : words )
+	{
+		if ( letters.encode( w.first, symbols ) )
+		{
+			words[ encoded ].first.swap( symbols );
+			words[ encoded ].second = w.second;
+			++encoded;
+		}
+	}
+
+	if ( encoded != words.size() )
+		std::cerr << words.size() - encoded << " words use letters beyond the " << MAX_LETTERS << " we can index, they've been left out" << std::endl;
+
+	words.resize( encoded );
+
+	// group by length, then alphabetically within a length. word lists
+	// are usually sorted already so only the stable length sort costs much
+	auto alphabetical = []( entry const & a, entry const & b ) { return a.first < b.first; };
+
+	if ( !std::is_sorted( words.begin(), words.end(), alphabetical ) )
+		std::sort( words.begin(), words.end(), alphabetical );
+
+	std::stable_sort( words.begin(), words.end(), []( entry const & a, entry const & b ) { return a.first.size() < b.first.size(); } );
+
+	// a word listed twice keeps the larger of its frequencies
+	std::size_t kept = 0;
+
+	for ( std::size_t i = 0 ; i < words.size() ; ++i )
+	{
+		if ( kept != 0 && words[ kept - 1 ].first == words[ i ].first )
+			words[ kept - 1 ].second = std::max( words[ kept - 1 ].second, words[ i ].second );
+		else if ( kept++ != i )
+			words[ kept - 1 ] = std::move( words[ i ] );
+	}
+
+	words.resize( kept );
+
+	header h;
+	std::memcpy( h._magic, magic, sizeof( magic ) );
+	h._version = version;
+	h._words = static_cast< std::uint32_t >( words.size() );
+	h._maxLength = words.empty() ? 0 : static_cast< std::uint32_t >( words.back().first.size() );
+	h._textSize = 0;
+	h._ranked = std::any_of( words.begin(), words.end(), []( entry const & w ) { return w.second != 0; } ) ? 1 : 0;
+	h._letters = static_cast< std::uint32_t >( letters.size() );
+
+	for ( std::size_t c = 0 ; c < MAX_LETTERS ; ++c )
+		h._alphabet[ c ] = c < letters.size() ? letters.code( c ) : 0;
+
+	for ( auto const & w : words )
+		h._textSize += static_cast< std::uint32_t >( w.first.size() + 1 );
+
+	std::vector< lengthgroup > lengths( h._maxLength + 1 );
+	std::vector< std::uint32_t > offsets;
+	std::vector< letterset > letterSets;
+	std::vector< std::uint32_t > frequencies;
+	std::vector< char > text;
+
+	offsets.reserve( words.size() );
+	letterSets.reserve( words.size() );
+	frequencies.reserve( words.size() );
+	text.reserve( h._textSize );
+
+	// fill in the first letter index, every slot points at the first
+	// word whose first letter is >= that slot's letter
+	std::uint32_t i = 0;
+	for ( std::size_t l = 0 ; l <= h._maxLength ; ++l )
+	{
+		for ( std::size_t c = 0 ; c < MAX_LETTERS ; ++c )
+		{
+			while ( i < words.size() && words[ i ].first.size() == l && letterIndex( words[ i ].first[ 0 ] ) < c )
+				++i;
+
+			lengths[ l ]._index[ c ] = i;
+		}
+
+		while ( i < words.size() && words[ i ].first.size() == l )
+			++i;
+
+		lengths[ l ]._index[ MAX_LETTERS ] = i;
+	}
+
+	for ( auto const & w : words )
+	{
+		offsets.push_back( static_cast< std::uint32_t >( text.size() ) );
+		letterSets.push_back( lettersOf( w.first.c_str() ) );
+		frequencies.push_back( w.second );
+		text.insert( text.end(), w.first.c_str(), w.first.c_str() + w.first.size() + 1 );
+	}
+
+	image.clear();
+	image.reserve( sizeof( h ) + lengths.size() * sizeof( lengthgroup ) + words.size() * ( sizeof( std::uint32_t ) * 2 + sizeof( letterset ) ) + text.size() );
+
+	auto append = [ &image ]( void const * p, std::size_t n )
+	{
+		image.insert( image.end(), static_cast< char const * >( p ), static_cast< char const * >( p ) + n );
+	};
+
+	// the letter sets first, while everything is still 8 byte aligned
+	append( &h, sizeof( h ) );
+	append( letterSets.data(), letterSets.size() * sizeof( letterset ) );
+	append( lengths.data(), lengths.size() * sizeof( lengthgroup ) );
+	append( offsets.data(), offsets.size() * sizeof( std::uint32_t ) );
+	append( frequencies.data(), frequencies.size() * sizeof( std::uint32_t ) );
+	append( text.data(), text.size() );
+
+	return true;
+}
+
+bool dictionary::attach( char const * image, std::size_t size ) throw()
+{
+	if ( size < sizeof( header ) )
+		return false;
+
+	header const * h = reinterpret_cast< header const * >( image );
+
+	if ( !isMagic( h->_magic ) )
+		return false;
+
+	if ( h->_version != version )
+	{
+		std::cerr << "dictionary image is version " << h->_version << ", expected " << version << ", recompile it" << std::endl;
+		return false;
+	}
+
+	// past the header nothing is used until it's been checked to lie
+	// within the image, a damaged or cut short file would otherwise be
+	// read wherever its offsets point
+	auto damaged = []()
+	{
+		std::cerr << "dictionary image is damaged, recompile it" << std::endl;
+		return false;
+	};
+
+	if ( h->_letters < 26 || h->_letters > MAX_LETTERS )
+		return damaged();
+
+	std::size_t expected = sizeof( header ) + ( std::size_t( h->_maxLength ) + 1 ) * sizeof( lengthgroup ) + std::size_t( h->_words ) * ( sizeof( std::uint32_t ) * 2 + sizeof( letterset ) ) + h->_textSize;
+
+	if ( size != expected )
+		return damaged();
+
+	auto letters = reinterpret_cast< letterset const * >( image + sizeof( header ) );
+	auto lengths = reinterpret_cast< lengthgroup const * >( letters + h->_words );
+	auto offsets = reinterpret_cast< std::uint32_t const * >( lengths + h->_maxLength + 1 );
+	auto frequencies = reinterpret_cast< std::uint32_t const * >( offsets + h->_words );
+	auto text = reinterpret_cast< char const * >( frequencies + h->_words );
+
+	// each length's first letter index runs in order and stays within the words
+	for ( std::size_t l = 0 ; l <= h->_maxLength ; ++l )
+	{
+		auto const & index = lengths[ l ]._index;
+
+		if ( index[ MAX_LETTERS ] > h->_words )
+			return damaged();
+
+		for ( std::size_t c = 0 ; c < MAX_LETTERS ; ++c )
+		{
+			if ( index[ c ] > index[ c + 1 ] )
+				return damaged();
+		}
+	}
+
+	// the text is words of the alphabet's letters no longer than the
+	// longest, each ending in a 0, and every word starts inside it
+	if ( h->_textSize == 0 ? h->_words != 0 : text[ h->_textSize - 1 ] != 0 )
+		return damaged();
+
+	std::size_t length = 0;
+
+	for ( std::size_t i = 0 ; i < h->_textSize ; ++i )
+	{
+		if ( text[ i ] == 0 )
+			length = 0;
+		else if ( letterIndex( text[ i ] ) >= h->_letters || ++length > h->_maxLength )
+			return damaged();
+	}
+
+	for ( std::size_t i = 0 ; i < h->_words ; ++i )
+	{
+		if ( offsets[ i ] >= h->_textSize )
+			return damaged();
+	}
+
+	_header = h;
+	_letters = letters;
+	_lengths = lengths;
+	_offsets = offsets;
+	_frequencies = frequencies;
+	_text = text;
+	_alphabet = alphabet( std::vector< std::uint32_t >( h->_alphabet + 26, h->_alphabet + h->_letters ) );
+
+	// the same letters mean different things in different alphabets, an
+	// english list has only the one so it's named by its words alone
+	_fingerprint = hash( _text, h->_textSize, h->_letters > 26 ? hash( h->_alphabet, h->_letters * sizeof( std::uint32_t ) ) : hash( nullptr, 0 ) );
+
+	return true;
+}
+
+bool dictionary::good() const throw()
+{
+	return _header != nullptr;
+}
+
+bool dictionary::mapped() const throw()
+{
+	return _map != nullptr;
+}
+
+std::size_t dictionary::size() const throw()
+{
+	return _header ? _header->_words : 0;
+}
+
+std::size_t dictionary::maxLength() const throw()
+{
+	return _header ? _header->_maxLength : 0;
+}
+
+dictionary::range dictionary::words( std::size_t length, char first ) const throw()
+{
+	if ( _header == nullptr || length > _header->_maxLength || letterIndex( first ) >= _header->_letters )
+		return range( 0, 0 );
+
+	auto const & g = _lengths[ length ];
+
+	return range( g._index[ letterIndex( first ) ], g._index[ letterIndex( first ) + 1 ] );
+}
+
+char const * dictionary::word( std::uint32_t i ) const throw()
+{
+	return _text + _offsets[ i ];
+}
+
+dictionary::letterset dictionary::letters( std::uint32_t i ) const throw()
+{
+	return _letters[ i ];
+}
+
+bool dictionary::contains( std::string const & word ) const throw()
+{
+	if ( word.empty() )
+		return false;
+
+	// the words of a length starting with a letter are sorted
+	auto r = words( word.size(), word[ 0 ] );
+	auto first = _offsets + r.first;
+	auto last = _offsets + r.second;
+
+	auto at = std::lower_bound( first, last, word, [ this ]( std::uint32_t offset, std::string const & w ) { return std::strcmp( _text + offset, w.c_str() ) < 0; } );
+
+	return at != last && word == _text + *at;
+}
+
+bool dictionary::ranked() const throw()
+{
+	return _header != nullptr && _header->_ranked != 0;
+}
+
+std::uint32_t dictionary::frequency( char const * word ) const throw()
+{
+	if ( _header == nullptr || word < _text || word >= _text + _header->_textSize )
+		return 0;
+
+	// the words are laid out in index order, so their offsets are sorted
+	auto at = std::lower_bound( _offsets, _offsets + _header->_words, static_cast< std::uint32_t >( word - _text ) );
+
+	if ( at == _offsets + _header->_words || *at != static_cast< std::uint32_t >( word - _text ) )
+		return 0;
+
+	return _frequencies[ at - _offsets ];
+}
+
+std::uint64_t dictionary::fingerprint() const throw()
+{
+	return _fingerprint;
+}
+
+std::uint64_t dictionary::hash( void const * p, std::size_t n, std::uint64_t h ) throw()
+{
+	for ( auto c = static_cast< unsigned char const * >( p ) ; n-- > 0 ; ++c )
+		h = ( h ^ *c ) * 1099511628211ull;
+
+	return h;
+}
+
+dictionary::letterset dictionary::lettersOf( char const * word ) throw()
+{
+	letterset s = 0;
+
+	for ( ; *word ; ++word )
+	{
+		if ( isLetter( *word ) )
+			s |= letterset( 1 ) << letterIndex( *word );
+	}
+
+	return s;
+}
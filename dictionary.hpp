@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+#include "alphabet.hpp"
+
+// the full word list, held as a single read only image.
+//
+// the image is either mapped straight from a file written by compile()
+// or, when given a plain text word list, built in memory in the same
+// layout. either way the words are grouped by length, sorted within a
+// group and indexed by first letter, and each word carries a bitmask of
+// the letters it uses so it can be filtered against a grid without
+// looking at its text. a word list can give how common each word is, a
+// count after the word, which is kept alongside it.
+//
+// the words are utf-8 but the image holds them as letters of the list's
+// own alphabet, a byte each, see alphabet.hpp. the alphabet is saved with
+// them.
+//
+// wordcache keeps pointers into the image, so the dictionary must
+// outlive any wordcache built from it.
+class dictionary
+{
+public:
+	typedef std::uint64_t letterset;
+	typedef std::pair< std::uint32_t, std::uint32_t > range;
+
+	explicit dictionary( std::string const & file );
+	~dictionary();
+
+	dictionary( dictionary const & ) = delete;
+	dictionary & operator=( dictionary const & ) = delete;
+
+	// write a binary image of the text word list "in" to "out"
+	static bool compile( std::string const & in, std::string const & out ) throw();
+
+	bool good() const throw();
+	bool mapped() const throw();
+
+	std::size_t size() const throw();
+	std::size_t maxLength() const throw();
+
+	// the letters the words are made of
+	inline alphabet const & symbols() const throw() { return _alphabet; }
+
+	// the indexes of the words of the given length starting with the given letter
+	range words( std::size_t length, char first ) const throw();
+
+	char const * word( std::uint32_t i ) const throw();
+	letterset letters( std::uint32_t i ) const throw();
+
+	// the word, as letters, is one of the list's
+	bool contains( std::string const & word ) const throw();
+
+	static letterset lettersOf( char const * word ) throw();
+
+	// the word list gave how common its words are
+	bool ranked() const throw();
+
+	// how common a word in the image is, 0 if the list didn't say or the
+	// word isn't one of the image's own
+	std::uint32_t frequency( char const * word ) const throw();
+
+	// identifies the word list, two images holding the same words have
+	// the same fingerprint whatever file they came from
+	std::uint64_t fingerprint() const throw();
+
+	// a 64 bit fnv-1a hash, it has to stay the same from build to build
+	// as it names things saved to disk
+	static std::uint64_t hash( void const * p, std::size_t n, std::uint64_t h = 14695981039346656037ull ) throw();
+
+private:
+
+	struct header
+	{
+		char			_magic[ 8 ];
+		std::uint32_t	_version;
+		std::uint32_t	_words;
+		std::uint32_t	_maxLength;
+		std::uint32_t	_textSize;
+		std::uint32_t	_ranked;	// the frequencies aren't all 0
+		std::uint32_t	_letters;
+		std::uint32_t	_alphabet[ MAX_LETTERS ];	// the code point of each letter
+	};
+
+	// one per word length, _index[ c ] is the first word starting with
+	// letter c, _index[ MAX_LETTERS ] is one past the last word of this length
+	struct lengthgroup
+	{
+		std::uint32_t	_index[ MAX_LETTERS + 1 ];
+	};
+
+	static bool build( std::vector< std::pair< std::string, std::uint32_t > > & words, std::vector< char > & image ) throw();
+
+	bool attach( char const * image, std::size_t size ) throw();
+
+	std::vector< char >		_buffer;
+	void *					_map;
+	std::size_t				_mapSize;
+
+	header const *			_header;
+	letterset const *		_letters;
+	lengthgroup const *		_lengths;
+	std::uint32_t const *	_offsets;
+	std::uint32_t const *	_frequencies;
+	char const *			_text;
+	std::uint64_t			_fingerprint;
+	alphabet				_alphabet;
+};
@@ -4,102 +4,263 @@
 #include <memory>
 #include <cstring>
 #include <bitset>
+#include <map>
+#include <algorithm>
+#include <mutex>
 
 #include "grid.hpp"
 
-grid::grid( std::size_t h, std::size_t w, std::string const & letters ) :
+namespace
+{
+	// the cells surrounding each cell only depend on the grid dimensions so
+	// we work them out once per size and every grid of that size shares them
+	template< std::size_t Bits >
+	wordpath< Bits > const * neighbourTable( std::size_t h, std::size_t w ) throw()
+	{
+		typedef std::array< wordpath< Bits >, Bits > neighbourtable;
+
+		static std::mutex lock;
+		static std::map< std::pair< std::size_t, std::size_t >, std::unique_ptr< neighbourtable > > tables;
+
+		std::lock_guard< std::mutex > g( lock );
+
+		auto & table = tables[ std::make_pair( h, w ) ];
+
+		if ( !table )
+		{
+			table.reset( new neighbourtable );
+
+			for ( std::size_t pos = 0 ; pos < h * w ; ++pos )
+			{
+				std::size_t y = pos / w;
+				std::size_t x = pos % w;
+
+				for ( std::size_t ny = ( y > 0 ? y - 1 : 0 ) ; ny <= y + 1 && ny < h ; ++ny )
+				{
+					for ( std::size_t nx = ( x > 0 ? x - 1 : 0 ) ; nx <= x + 1 && nx < w ; ++nx )
+					{
+						if ( ny != y || nx != x )
+							(*table)[ pos ].set( ny * w + nx );
+					}
+				}
+			}
+		}
+
+		return table->data();
+	}
+}
+
+template< std::size_t Bits, std::size_t Letters >
+grid< Bits, Letters >::grid( std::size_t h, std::size_t w, std::string const & letters ) :
 	_h( h ),
 	_w( w ),
 	_s( h * w ),
-	_l( letters )
+	_neighbours( neighbourTable< Bits >( h, w ) )
 {
+	_l.fill( ' ' );
+	std::copy( letters.begin(), letters.begin() + std::min( letters.size(), _l.size() ), _l.begin() );
+
+	std::size_t wild = 0;
+	for ( std::size_t p = 0 ; p < _s ; ++p )
+	{
+		if ( _l[ p ] == '?' )
+			_l[ p ] = wildcard( wild++ );
+	}
+
+	buildMasks();
+}
+
+template< std::size_t Bits, std::size_t Letters >
+grid< Bits, Letters >::grid( std::size_t h, std::size_t w, letterarray const & letters, path const * neighbours ) :
+	_h( h ),
+	_w( w ),
+	_s( h * w ),
+	_l( letters ),
+	_neighbours( neighbours )
+{
+	buildMasks();
 }
 
-grid grid::remove( wordpath const & path ) const throw()
+template< std::size_t Bits, std::size_t Letters >
+void grid< Bits, Letters >::buildMasks() throw()
 {
-	// use a bitset to hold which columns we need to process
-	// for moving characters down when letters are removed
-	std::bitset< MAX_BITS > col_modified;
+	_occupied.reset();
+	_wild.reset();
 
-	std::string new_l( _l );
+	for ( auto & c : _cells )
+		c.reset();
 
 	for ( std::size_t p = 0 ; p < _s ; ++p )
 	{
-		if ( path.test( p ) )
+		char c = _l[ p ];
+
+		if ( isLetter( c ) || isWild( c ) )
 		{
-			new_l[ p ] = ' ';
-			col_modified.set( p % _w );
+			_occupied.set( p );
+			mark( c, p );
 		}
 	}
+}
+
+template< std::size_t Bits, std::size_t Letters >
+grid< Bits, Letters > grid< Bits, Letters >::remove( path const & removed ) const throw()
+{
+	// taking letters out is one pass up each column they came from,
+	// moving the letters that stay down over the gaps. the masks are
+	// patched for the cells that change rather than rebuilt from the
+	// whole grid
+	grid g( *this );
 
-	bool modified;
-	char *lower, *upper;
+	std::bitset< Bits > columns;
+
+	for ( path p( removed ) ; p.any() ; )
+	{
+		std::size_t pos = p.lowest();
+		p.reset( pos );
+		columns.set( pos % _w );
+	}
 
 	for ( std::size_t c = 0 ; c < _w ; ++c )
 	{
-		if ( col_modified.test( c ) == 0 )
+		if ( !columns.test( c ) )
 			continue;
 
-		do {
-			modified = false;
+		std::size_t to = _h;	// the row the next letter that stays falls to, one past it
+
+		for ( std::size_t row = _h ; row > 0 ; --row )
+		{
+			std::size_t pos = ( row - 1 ) * _w + c;
+			char ch = _l[ pos ];
+
+			if ( ch == ' ' )
+				continue;
 
-			for ( std::size_t pos = c + _w ; pos < _s ; pos += _w )
+			if ( removed.test( pos ) )
 			{
-				lower = &new_l[ pos ];
-				upper = lower - _w;
+				g.unmark( ch, pos );
+				continue;
+			}
 
-				if ( *lower == ' ' &&
-					 *upper != ' ' )
-				{
-					std::swap( *upper, *lower );
-					modified = true;
-				}
+			std::size_t dest = ( --to ) * _w + c;
+
+			if ( dest != pos )
+			{
+				g._l[ dest ] = ch;
+				g.unmark( ch, pos );
+				g.mark( ch, dest );
+				g._occupied.set( dest );
 			}
-		} while( modified );
+		}
+
+		// everything above the letters that stayed is now empty
+		for ( std::size_t row = to ; row > 0 ; --row )
+		{
+			std::size_t pos = ( row - 1 ) * _w + c;
+
+			g._l[ pos ] = ' ';
+			g._occupied.reset( pos );
+		}
+	}
+
+	return g;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+lettercounts grid< Bits, Letters >::counts() const throw()
+{
+	lettercounts counts;
+	counts.fill( 0 );
+
+	if ( _wild.none() )
+	{
+		for ( std::size_t c = 0 ; c < _cells.size() ; ++c )
+			counts[ c ] = static_cast< std::uint8_t >( _cells[ c ].count() );
+	}
+	else
+	{
+		for ( std::size_t c = 0 ; c < _cells.size() ; ++c )
+			counts[ c ] = static_cast< std::uint8_t >( ( _cells[ c ] & ~_wild ).count() );
 	}
-	
-	return grid( _h, _w, new_l );
+
+	return counts;
 }
 
+template< std::size_t Bits, std::size_t Letters >
+std::size_t grid< Bits, Letters >::columnRuns( std::array< std::size_t, Bits > & runs ) const throw()
+{
+	std::size_t n = 0;
+	bool inRun = false;
+
+	for ( std::size_t c = 0 ; c < _w ; ++c )
+	{
+		std::size_t letters = 0;
+
+		for ( std::size_t pos = c ; pos < _s ; pos += _w )
+		{
+			if ( _occupied.test( pos ) )
+				++letters;
+		}
 
-void grid::display() const throw()
+		if ( letters == 0 )
+			inRun = false;
+		else
+		{
+			if ( !inRun )
+				runs[ n++ ] = 0;
+
+			runs[ n - 1 ] += letters;
+			inRun = true;
+		}
+	}
+
+	return n;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+void grid< Bits, Letters >::display( std::ostream & out, alphabet const & letters ) const throw()
 {
 	for ( std::size_t p = 0 ; p < _s ; ++p )
 	{
 		if ( p > 0 && ( p % _w ) == 0 )
-			std::cout << std::endl;
+			out << std::endl;
 
-		std::cout << _l[ p ] << " ";
+		out << ( isWild( _l[ p ] ) ? std::string( "?" ) : letters.decode( &_l[ p ], 1 ) ) << " ";
 	}
-	std::cout << std::endl;
+	out << std::endl;
 }
 
-void grid::display( std::string const & word, wordpath const & path ) const throw()
+template< std::size_t Bits, std::size_t Letters >
+void grid< Bits, Letters >::display( std::ostream & out, alphabet const & letters, char const * word, path const & p ) const throw()
 {
-	std::cout << word << " = " << std::endl;
+	out << letters.decode( word, std::strlen( word ) ) << " = " << std::endl;
 
 	for ( std::size_t pos = 0 ; pos < _s ; ++pos )
 	{
 		if ( pos > 0 && ( pos % _w ) == 0 )
-			std::cout << std::endl;
+			out << std::endl;
 
-		if ( path.test( pos ) )
-			std::cout << (char)::toupper( _l[ pos ] );
+		if ( isWild( _l[ pos ] ) )
+			out << '?';
+		else if ( p.test( pos ) )
+			out << letters.capital( _l[ pos ] );
 		else
-			std::cout << _l[ pos ];
+			out << letters.decode( &_l[ pos ], 1 );
 
-		std::cout << " ";
+		out << " ";
 	}
 
-	std::cout << std::endl;
+	out << std::endl;
 }
 
-bool grid::empty() const throw()
+template< std::size_t Bits, std::size_t Letters >
+bool grid< Bits, Letters >::empty() const throw()
 {
-	for ( auto const & c : _l )
-	{
-		if ( c != ' ' )
-			return false;
-	}
-	return true;
+	return _occupied.none();
 }
+
+template class grid< 64, ENGLISH_LETTERS >;
+template class grid< 128, ENGLISH_LETTERS >;
+template class grid< 256, ENGLISH_LETTERS >;
+template class grid< 64, MAX_LETTERS >;
+template class grid< 128, MAX_LETTERS >;
+template class grid< 256, MAX_LETTERS >;
@@ -1,29 +1,132 @@
 #pragma once
 #include <string>
+#include <array>
+#include <ostream>
+#include <cstdint>
 
 #include "wordpath.hpp"
+#include "alphabet.hpp"
 
+// how many of each letter, one for every letter an alphabet can have so
+// comparing two of them is a few vector instructions
+typedef std::array< std::uint8_t, MAX_LETTERS > lettercounts;
+
+// how many letters a word needs that aren't there, which only cells we
+// couldn't read can make up. only the first Letters are looked at, the
+// rest are always 0 in an alphabet that small
+template< std::size_t Letters = MAX_LETTERS >
+inline std::size_t shortfall( lettercounts const & need, lettercounts const & have ) throw()
+{
+	std::size_t n = 0;
+	for ( std::size_t c = 0 ; c < Letters ; ++c )
+		n += need[ c ] > have[ c ] ? need[ c ] - have[ c ] : 0;
+	return n;
+}
+
+// Bits cells, holding letters of an alphabet of at most Letters letters
+template< std::size_t Bits, std::size_t Letters >
 class grid
 {
 public:
+	typedef wordpath< Bits > path;
+
+	// fixed size so that grids can be copied and built during a search without touching the heap
+	typedef std::array< char, Bits > letterarray;
+
 	grid( std::size_t h, std::size_t w, std::string const & letters );
 
+	// a '?' in the letters is a cell we couldn't read, it could be any
+	// letter. each one is held as a character of its own below ' ' so it
+	// can be told apart from the others wherever it falls to, and it's in
+	// the cells of every letter
+	static std::size_t const maxWildcards = ' ' - 1;
+
+	static inline bool isWild( char c ) throw() { return c > 0 && c < ' '; }
+	static inline char wildcard( std::size_t i ) throw() { return static_cast< char >( i + 1 ); }
+	static inline std::size_t wildIndex( char c ) throw() { return static_cast< std::size_t >( c - 1 ); }
+
 	inline std::size_t height() const  throw() { return _h; }
 	inline std::size_t width() const  throw() { return _w; }
 	inline std::size_t size() const  throw() { return _s; }
 
 	inline char operator[]( std::size_t pos ) const  throw() { return _l[ pos ]; }
 
-	grid remove( wordpath const & path ) const throw();
+	inline letterarray const & letters() const throw() { return _l; }
+
+	// the cells that hold letters, the cells that hold a particular letter
+	// and the cells surrounding a cell
+	inline path const & occupied() const throw() { return _occupied; }
+	inline path const & cells( char c ) const throw() { return _cells[ letterIndex( c ) ]; }
+	inline path const & neighbours( std::size_t pos ) const throw() { return _neighbours[ pos ]; }
+
+	// the cells we couldn't read
+	inline path const & wild() const throw() { return _wild; }
 
-	void display() const throw();
-	void display( std::string const & word,  wordpath const & path ) const throw();
+	// every cell next to any of the given cells
+	inline path around( path const & p ) const throw()
+	{
+		path r;
+		for ( path q( p ) ; q.any() ; )
+		{
+			std::size_t pos = q.lowest();
+			q.reset( pos );
+			r |= _neighbours[ pos ];
+		}
+		return r;
+	}
+
+	grid remove( path const & p ) const throw();
+
+	// how many of each letter, not counting the wildcards
+	lettercounts counts() const throw();
+
+	// the number of letters in each run of adjacent non-empty columns. words can't
+	// cross an empty column and empty columns never fill, so each run has to be
+	// made up of whole words
+	std::size_t columnRuns( std::array< std::size_t, Bits > & runs ) const throw();
+
+	void display( std::ostream & out, alphabet const & letters ) const throw();
+	void display( std::ostream & out, alphabet const & letters, char const * word,  path const & p ) const throw();
 
 	bool empty() const throw();
 
 private:
+	grid( std::size_t h, std::size_t w, letterarray const & letters, path const * neighbours );
+
+	void buildMasks() throw();
+
+	// a letter goes in the cells of its own letter, a wildcard in all of them
+	inline void mark( char c, std::size_t pos ) throw()
+	{
+		if ( !isWild( c ) )
+			_cells[ letterIndex( c ) ].set( pos );
+		else
+		{
+			_wild.set( pos );
+			for ( auto & cells : _cells )
+				cells.set( pos );
+		}
+	}
+
+	inline void unmark( char c, std::size_t pos ) throw()
+	{
+		if ( !isWild( c ) )
+			_cells[ letterIndex( c ) ].reset( pos );
+		else
+		{
+			_wild.reset( pos );
+			for ( auto & cells : _cells )
+				cells.reset( pos );
+		}
+	}
+
 	std::size_t _h;
 	std::size_t	_w;
 	std::size_t	_s;
-	std::string	_l;
+	letterarray	_l;
+
+	path					_occupied;
+	path					_wild;
+	std::array< path, Letters >	_cells;
+	path const *			_neighbours;	// shared by all grids of these dimensions
 };
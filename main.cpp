@@ -11,169 +11,776 @@
 #include <list>
 #include <tuple>
 #include <bitset>
+#include <cstdlib>
+#include <memory>
+#include <iterator>
+#include <chrono>
 #include <tbb/tbb.h>
 
+#include "dictionary.hpp"
 #include "wordcache.hpp"
 #include "wordhint.hpp"
 #include "wordpath.hpp"
 #include "grid.hpp"
 #include "puzzle.hpp"
+#include "puzzledef.hpp"
+#include "solutioncache.hpp"
 
 namespace
 {
-    bool wellFormedHint( std::string const & word ) throw()
+    struct batchjob
     {
-        if ( word.empty() )
-            return false;
+        std::string line;
+        std::string output;
+    };
+
+    // a --cache file and the exclude list to apply to what comes out of it
+    struct caching
+    {
+        solutioncache *             cache;
+        std::uint64_t               fingerprint;
+        std::vector< std::string >  excluded;
+    };
+
+    // a solution is out if the dictionary gave it an excluded word, words
+    // given in full by a hint stand whatever the exclude list says
+    bool excluded( std::string const & solution, wordhints const & hints, std::vector< std::string > const & words ) throw()
+    {
+        std::istringstream ss( solution );
+        std::string w;
+
+        for ( std::size_t i = 0 ; ss >> w ; ++i )
+        {
+            bool given = i < hints.size() && givenWord( hints[ i ] );
+
+            if ( !given && std::binary_search( words.begin(), words.end(), w ) )
+                return true;
+        }
+
+        return false;
+    }
+
+    // a json string, a batch line or an error can hold anything
+    std::string quoted( std::string const & s ) throw()
+    {
+        static char const hex[] = "0123456789abcdef";
+
+        std::string q( "\"" );
+
+        for ( auto c : s )
+        {
+            if ( c == '"' || c == '\\' )
+                q += std::string( "\\" ) + c;
+            else if ( c == '\t' )
+                q += "\\t";
+            else if ( c == '\n' )
+                q += "\\n";
+            else if ( c == '\r' )
+                q += "\\r";
+            else if ( static_cast< unsigned char >( c ) < 0x20 )
+                q += std::string( "\\u00" ) + hex[ c >> 4 ] + hex[ c & 0xf ];
+            else
+                q += c;
+        }
+
+        return q + "\"";
+    }
+
+    // a solution read back from the cache, which only has its words
+    void writeSolution( std::string const & solution, alphabet const & letters, searchoptions const & options, std::ostream & out ) throw()
+    {
+        if ( options.format != outputformat::jsonl )
+        {
+            out << letters.decode( solution ) << std::endl;
+            return;
+        }
+
+        std::istringstream ss( solution );
+        std::string w;
+
+        out << "{ \"solution\": [ ";
+        for ( std::size_t i = 0 ; ss >> w ; ++i )
+            out << ( i ? ", " : "" ) << quoted( letters.decode( w ) );
+        out << " ] }" << std::endl;
+    }
+
+    // print the solutions the exclude list leaves, no more than were asked for
+    template< typename Solutions >
+    std::size_t show( Solutions const & solutions, wordhints const & hints, alphabet const & letters, caching const & cached, searchoptions const & options, std::ostream & out ) throw()
+    {
+        std::size_t shown = 0;
+
+        for ( auto const & s : solutions )
+        {
+            if ( options.maxSolutions != 0 && shown >= options.maxSolutions )
+                break;
+
+            if ( excluded( s, hints, cached.excluded ) )
+                continue;
+
+            writeSolution( s, letters, options, out );
+            ++shown;
+        }
 
-        auto first_nonspace = word.find_first_not_of( " " );
+        return shown;
+    }
 
-        if ( first_nonspace == std::string::npos )
-            return false;    // word is all space
+    bool fromCache( puzzledef const & def, alphabet const & letters, caching const & cached, searchoptions const & options, std::ostream & out, bool summary ) throw()
+    {
+        std::vector< std::string > solutions;
 
-        auto first_space = word.find( ' ' );
+        if ( !cached.cache->find( def, cached.fingerprint, solutions ) )
+            return false;
 
-        if ( first_space == std::string::npos )
-            return true;    // no spaces, but letters..
+        auto shown = show( solutions, def.hints, letters, cached, options, out );
 
-        if ( first_space < first_nonspace )
-            return false;    // spaces have to be after characters
+        if ( options.format == outputformat::jsonl )
+        {
+            out << "{ \"cached\": " << shown << ", \"excluded\": " << solutions.size() - shown << " }" << std::endl;
+            return true;
+        }
 
-        if ( word.substr( first_space + 1 ).find_first_not_of( " " ) != std::string::npos )
-            return false;    // non space found after spaces
+        out << ( summary ? "" : "# " ) << shown << " solutions from the cache";
+        if ( options.maxSolutions == 0 && shown != solutions.size() )
+            out << ", " << solutions.size() - shown << " more use excluded words";
+        out << std::endl;
 
         return true;
     }
-}
 
-int main( int c, char *v[] )
-{
-    std::vector< std::string > args;
+    // grids are searched with the narrowest path that holds every cell
+    template< std::size_t Bits, std::size_t Letters >
+    void search( puzzledef const & def, wordcache const & words, searchoptions const & options, std::ostream & out, bool summary, caching const * cached ) throw()
+    {
+        std::ostream null( nullptr );
 
-    bool verbose = false;
+        // a search going into the cache is made without the exclude list,
+        // its solutions are only printed once the list has been applied
+        puzzle< Bits, Letters > p( words, options, cached ? null : out );
 
-    for ( auto i = 1 ; i < c ; ++i )
+        grid< Bits, Letters > letters( def.height, def.width, def.letters );
+
+        // json lines are only solutions and a line each for anything else
+        // worth knowing about the search
+        bool json = options.format == outputformat::jsonl;
+
+        if ( summary && !json )
+            letters.display( out, words.symbols() );
+
+        p.search( letters, def.hints );
+
+        if ( cached )
+        {
+            if ( !p.stopped() )
+                cached->cache->add( def, cached->fingerprint, p.solutions() );
+
+            show( p.solutions(), def.hints, words.symbols(), *cached, options, out );
+        }
+
+        if ( json )
+        {
+            if ( p.stopped() )
+                out << "{ \"stopped\": " << p.solutions().size() << ", \"timed_out\": " << ( p.timedOut() ? "true" : "false" )
+                    << ", \"max_states\": " << ( p.outOfStates() ? "true" : "false" ) << " }" << std::endl;
+
+            if ( options.stats )
+            {
+                std::ostringstream stats;
+                p.writeStats( stats );
+
+                auto text = stats.str();
+                out << "{ \"stats\": " << text.substr( 0, text.find_last_not_of( "\n" ) + 1 ) << " }" << std::endl;
+            }
+
+            return;
+        }
+
+        if ( p.timedOut() )
+            out << ( summary ? "" : "# " ) << "search timed out after " << options.timeout << "s" << std::endl;
+        else if ( p.outOfStates() )
+            out << ( summary ? "" : "# " ) << "search stopped after " << p.solutions().size() << " solutions, it kept " << options.maxStates
+                << " partial solutions and had no room for more, raise --max-states to find the rest" << std::endl;
+        else if ( p.stopped() )
+            out << ( summary ? "" : "# " ) << "search stopped after " << p.solutions().size() << " solutions" << std::endl;
+
+        if ( options.stats )
+        {
+            out << ( summary ? "stats : " : "# stats " );
+            p.writeStats( out );
+        }
+
+        // how much the pruning saved is for looking into a search, not
+        // part of the answer
+        if ( !summary || !( options.stats || options.verbose ) )
+            return;
+
+        if ( options.feasibility )
+            out << p.prunedByLetters() + p.prunedByColumns() << " grids pruned as infeasible ( " << p.prunedByLetters() << " by letter counts, " << p.prunedByColumns() << " by column runs )" << std::endl;
+
+        if ( options.constrainedFirst )
+            out << p.prunedByHints() << " grids pruned where a later hint could no longer be met" << std::endl;
+    }
+
+    void search( puzzledef const & def, wordcache const & words, searchoptions const & options, std::ostream & out, bool summary, caching const * cached ) throw()
     {
-        std::string a( v[ i ] );
-        if ( a == "-v" )
-            verbose = true;
+        withBits( def.height * def.width, words.symbols().size(), [ & ]( auto bits, auto letters ) { search< bits, letters >( def, words, options, out, summary, cached ); } );
+    }
+
+    // only a search that can find every solution is worth saving
+    bool saving( caching const * cached, searchoptions const & options ) throw()
+    {
+        return cached != nullptr && options.maxSolutions == 0;
+    }
+
+    void solve( batchjob & job, dictionary const & dict, std::vector< std::string > const & excluded, searchoptions const & options, caching const * cached ) throw()
+    {
+        std::ostringstream out;
+        std::ostream null( nullptr );   // the word cache is chatty, we don't want that per puzzle
+
+        bool json = options.format == outputformat::jsonl;
+
+        if ( json )
+            out << "{ \"puzzle\": " << quoted( job.line ) << " }" << std::endl;
         else
+            out << job.line << std::endl;
+
+        auto args = splitPuzzleLine( job.line );
+
+        // lines are usually "puzzle height width ...", skip the program name
+        if ( !args.empty() && !::isdigit( static_cast< unsigned char >( args[ 0 ][ 0 ] ) ) )
+            args.erase( args.begin() );
+
+        puzzledef def;
+        std::string error;
+
+        if ( !parsePuzzle( args, dict.symbols(), def, error ) )
         {
-            // mainly for windows but we need to remove any quotes from the hints
-            std::string::size_type quote;
-            while( (quote = a.find_first_of( "\"'" ) ) != std::string::npos )
-                a.replace( quote, 1, "" );
-            args.push_back( a );
+            if ( json )
+                out << "{ \"error\": " << quoted( error ) << " }" << std::endl;
+            else
+                out << "# error: " << error << std::endl;
         }
+        else if ( cached == nullptr || !fromCache( def, dict.symbols(), *cached, options, out, false ) )
+        {
+            bool save = saving( cached, options );
+
+            wordcache words( dict, def.hints, def.letters, null, save ? std::vector< std::string >() : excluded );
+
+            search( def, words, options, out, false, save ? cached : nullptr );
+        }
+
+        job.output = out.str();
     }
 
-    if ( args.size() < 4  )
+    // solve every puzzle line in a file ( or stdin ) against the one dictionary
+    // and exclude list, each puzzle's words are picked out of those. puzzles
+    // are solved concurrently but their results come out in input order
+    void batch( std::string const & file, dictionary const & dict, std::vector< std::string > const & excluded, searchoptions const & options, caching const * cached ) throw()
     {
-        std::cerr << "usage: " << v[ 0 ] << " [ -v ] height width letters wordsize [ wordsize .. ]" << std::endl;
-        std::cerr << "  Note. The sum of your words sizes much match ( height * width )" << std::endl;
-        exit( 1 );
+        std::fstream f;
+        std::istream * in = &std::cin;
+
+        if ( file != "-" )
+        {
+            f.open( file, std::ios::in );
+            if ( !f )
+            {
+                std::cerr << "unable to open batch file \"" << file << "\"" << std::endl;
+                exit( 1 );
+            }
+            in = &f;
+        }
+
+        tbb::parallel_pipeline( tbb::this_task_arena::max_concurrency() * 2,
+            tbb::make_filter< void, batchjob * >( tbb::filter_mode::serial_in_order, [ in ]( tbb::flow_control & fc ) -> batchjob *
+            {
+                std::string line;
+                while ( std::getline( *in, line ) )
+                {
+                    auto first = line.find_first_not_of( " \t\r" );
+                    if ( first == std::string::npos || line[ first ] == '#' )
+                        continue;
+
+                    auto last = line.find_last_not_of( " \t\r" );
+
+                    batchjob * job = new batchjob;
+                    job->line = line.substr( first, last - first + 1 );
+                    return job;
+                }
+
+                fc.stop();
+                return nullptr;
+            } ) &
+            tbb::make_filter< batchjob *, batchjob * >( tbb::filter_mode::parallel, [ &dict, &excluded, &options, cached ]( batchjob * job )
+            {
+                solve( *job, dict, excluded, options, cached );
+                return job;
+            } ) &
+            tbb::make_filter< batchjob *, void >( tbb::filter_mode::serial_in_order, []( batchjob * job )
+            {
+                std::cout << job->output << std::flush;
+                delete job;
+            } ) );
     }
 
-    std::size_t height( std::atoi( args[ 0 ].c_str() ) );
-    std::size_t width( std::atoi( args[ 1 ].c_str() ) );
-    std::string letters( args[ 2 ] );
-    std::transform( letters.begin(), letters.end(), letters.begin(), ::tolower );
+    // a puzzle narrowed down a step at a time, see session()
+    struct sessionstate
+    {
+        std::vector< std::string >                  args;       // the puzzle as it stands
+        puzzledef                                   def;
+        wordhints                                   searched;   // the hints the solutions were found with
+        std::vector< std::vector< std::string > >   solutions;  // every one, whatever is excluded
+        bool                                        complete;   // the search wasn't cut short
+        std::vector< std::string >                  excluded;   // sorted
+        std::vector< std::size_t >                  left;       // the solutions the puzzle allows now
+    };
 
-    if ( (height * width) > MAX_BITS )
+    void split( std::vector< std::string > const & solutions, sessionstate & s ) throw()
     {
-        std::cerr << "Sorry, you need to recompile with MAX_BITS increased to " << ( height * width ) << std::endl;
-        exit( 1 );
+        s.solutions.clear();
+
+        for ( auto const & text : solutions )
+        {
+            std::istringstream ss( text );
+            s.solutions.emplace_back( std::istream_iterator< std::string >( ss ), std::istream_iterator< std::string >() );
+        }
     }
 
-    if ( letters.size() != ( height * width ) )
+    template< std::size_t Bits, std::size_t Letters >
+    void searchAll( sessionstate & s, wordcache const & words, searchoptions const & options, caching const * cached ) throw()
     {
-        std::cerr << v[ 0 ] << ": letter count (" << letters.size() << ") doesn't match grid size (" << height << "x" << width << ")" << std::endl;
-        exit( 1 );
+        std::ostream null( nullptr );
+
+        puzzle< Bits, Letters > p( words, options, null );
+        grid< Bits, Letters > letters( s.def.height, s.def.width, s.def.letters );
+
+        p.search( letters, s.def.hints );
+
+        s.complete = !p.stopped();
+
+        if ( cached != nullptr && s.complete )
+            cached->cache->add( s.def, cached->fingerprint, p.solutions() );
+
+        split( p.solutions(), s );
     }
 
-    std::vector< wordhint > hints;
+    // search again from scratch, without the exclude list. the --cache
+    // holds solutions found the same way so it can stand in for the search
+    void searchAll( sessionstate & s, dictionary const & dict, searchoptions const & options, caching const * cached ) throw()
+    {
+        s.searched = s.def.hints;
+
+        std::vector< std::string > solutions;
+
+        if ( cached != nullptr && cached->cache->find( s.def, cached->fingerprint, solutions ) )
+        {
+            split( solutions, s );
+            s.complete = true;
+            return;
+        }
+
+        std::ostream null( nullptr );
+        wordcache words( dict, s.def.hints, s.def.letters, null, "" );
 
+        withBits( s.def.height * s.def.width, words.symbols().size(), [ & ]( auto bits, auto letters ) { searchAll< bits, letters >( s, words, options, cached ); } );
+    }
+
+    void narrow( sessionstate & s ) throw()
     {
-        for ( std::size_t s = 3 ; s < args.size() ; ++s )
+        s.left.clear();
+
+        for ( std::size_t i = 0 ; i < s.solutions.size() ; ++i )
         {
-            std::size_t val( std::atoi( args[ s ].c_str() ) );
-            if ( val == 0 )
+            auto const & words = s.solutions[ i ];
+            bool keep = words.size() == s.def.hints.size();
+
+            for ( std::size_t w = 0 ; keep && w < words.size() ; ++w )
             {
-                if ( args[ s ].empty() )
+                auto const & hint = s.def.hints[ w ];
+
+                keep = fitsHint( std::get< 1 >( hint ), words[ w ].c_str(), words[ w ].size() )
+                    && ( givenWord( hint ) || !std::binary_search( s.excluded.begin(), s.excluded.end(), words[ w ] ) );
+            }
+
+            if ( keep )
+                s.left.push_back( i );
+        }
+    }
+
+    // every solution the hints allow is one the hints searched with allow
+    // too, so it's among the solutions we have
+    bool narrower( wordhints const & hints, wordhints const & searched, dictionary const & dict ) throw()
+    {
+        if ( hints.size() != searched.size() )
+            return false;
+
+        for ( std::size_t i = 0 ; i < hints.size() ; ++i )
+        {
+            auto const & now = std::get< 1 >( hints[ i ] );
+            auto const & before = std::get< 1 >( searched[ i ] );
+
+            if ( std::get< 0 >( hints[ i ] ) != std::get< 0 >( searched[ i ] ) )
+                return false;
+
+            for ( std::size_t c = 0 ; c < before.size() ; ++c )
+            {
+                if ( before[ c ] != '.' && ( c >= now.size() || now[ c ] != before[ c ] ) )
+                    return false;
+            }
+
+            // a word given in full is an answer even when the word list
+            // doesn't have it, so the search may never have tried it
+            if ( givenWord( hints[ i ] ) && !givenWord( searched[ i ] ) && !dict.contains( now ) )
+                return false;
+        }
+
+        return true;
+    }
+
+    void status( sessionstate const & s, double ms, bool searched, searchoptions const & options, std::ostream & out ) throw()
+    {
+        if ( options.format == outputformat::jsonl )
+        {
+            out << "{ \"solutions\": " << s.left.size() << ", \"searched\": " << ( searched ? "true" : "false" ) << ", \"complete\": " << ( s.complete ? "true" : "false" ) << ", \"ms\": " << ms << " }" << std::endl;
+            return;
+        }
+
+        out << s.left.size() << " solutions" << ( searched ? ", searched" : ", narrowed" ) << " in " << ms << "ms";
+        if ( !s.complete )
+            out << ", the search was cut short so there may be more";
+        out << std::endl;
+    }
+
+    // solve a puzzle once and then take commands from stdin to narrow it
+    // down. the solutions are all kept, found without the exclude list,
+    // so excluding or including a word or giving more of a hint's letters
+    // only picks out the solutions that still fit. only a change that
+    // could let in a solution the search never found, a hint losing
+    // letters or a word given in full that isn't in the word list,
+    // searches again
+    void session( std::vector< std::string > const & args, dictionary const & dict, searchoptions options, caching const * cached ) throw()
+    {
+        bool json = options.format == outputformat::jsonl;
+
+        // it has to see every solution to be able to narrow them down
+        options.maxSolutions = 0;
+        options.bestFirst = false;
+
+        sessionstate s;
+        std::string error;
+
+        s.args = args;
+        s.excluded = wordcache::excludedWords( "exclude.txt", dict.symbols() );
+
+        if ( !parsePuzzle( s.args, dict.symbols(), s.def, error ) )
+        {
+            std::cerr << error << std::endl;
+            exit( 1 );
+        }
+
+        auto timed = [ &s, &dict, &options, cached ]( bool search )
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            if ( search )
+                searchAll( s, dict, options, cached );
+
+            narrow( s );
+
+            return std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - start ).count();
+        };
+
+        status( s, timed( true ), true, options, std::cout );
+
+        std::string line;
+
+        while ( ( json || std::cout << "> " << std::flush ) && std::getline( std::cin, line ) )
+        {
+            auto words = splitPuzzleLine( line );
+
+            if ( words.empty() )
+                continue;
+
+            auto const & command = words[ 0 ];
+
+            if ( command == "quit" || command == "exit" )
+                break;
+            else if ( command == "show" )
+            {
+                std::size_t n = words.size() > 1 ? std::strtoul( words[ 1 ].c_str(), nullptr, 10 ) : s.left.size();
+
+                for ( std::size_t i = 0 ; i < std::min( n, s.left.size() ) ; ++i )
                 {
-                    std::cerr << v[ 0 ] << ": empty hint" << std::endl;
-                    exit( 1 );
-                }
+                    std::string text;
+                    for ( auto const & w : s.solutions[ s.left[ i ] ] )
+                        text += w + " ";
 
-                if ( !wellFormedHint( args[ s ] ) )
+                    writeSolution( text, dict.symbols(), options, std::cout );
+                }
+            }
+            else if ( ( command == "exclude" || command == "include" ) && words.size() > 1 )
+            {
+                for ( auto w = words.begin() + 1 ; w != words.end() ; ++w )
                 {
-                    std::cerr << v[ 0 ] << ": hint \"" << args[ s ] << "\" is badly formed" << std::endl;
-                    exit( 1 );
+                    std::string word;
+
+                    // a word with letters the word list doesn't have can't be in a solution
+                    if ( !dict.symbols().encode( *w, word ) )
+                        continue;
+
+                    auto at = std::lower_bound( s.excluded.begin(), s.excluded.end(), word );
+                    bool there = at != s.excluded.end() && *at == word;
+
+                    if ( command == "exclude" && !there )
+                        s.excluded.insert( at, word );
+                    else if ( command == "include" && there )
+                        s.excluded.erase( at );
                 }
 
-                std::string w( args[ s ] );
-                std::transform( w.begin(), w.end(), w.begin(), ::tolower );
+                status( s, timed( false ), false, options, std::cout );
+            }
+            else if ( command == "hint" && words.size() > 1 )
+            {
+                std::size_t k = std::strtoul( words[ 1 ].c_str(), nullptr, 10 );
 
-                val = w.size();
+                if ( k == 0 || k + 3 > s.args.size() )
+                {
+                    std::cerr << "there's no hint " << words[ 1 ] << std::endl;
+                    continue;
+                }
 
-                auto last_char = w.find_last_not_of( " " );
-                if ( last_char != std::string::npos )
-                    w = w.substr( 0, last_char + 1 );
+                // just the length if no letters are given, letters short
+                // of the length are the start of the word
+                auto length = std::get< 0 >( s.def.hints[ k - 1 ] );
+                auto changed = s.args;
 
-                if ( val != w.size() )
-                    hints.emplace_back( val, w, "" );
+                if ( words.size() < 3 )
+                    changed[ k + 2 ] = std::to_string( length );
+                else if ( !std::isdigit( static_cast< unsigned char >( words[ 2 ][ 0 ] ) ) && alphabet::length( words[ 2 ] ) < length )
+                    changed[ k + 2 ] = words[ 2 ] + std::string( length - alphabet::length( words[ 2 ] ), '.' );
                 else
+                    changed[ k + 2 ] = words[ 2 ];
+
+                puzzledef def;
+
+                if ( !parsePuzzle( changed, dict.symbols(), def, error ) )
                 {
-                    std::string reversed( w );
-                    std::reverse( reversed.begin(), reversed.end() );
-                    hints.emplace_back( val, w, reversed );
+                    std::cerr << error << std::endl;
+                    continue;
                 }
+
+                s.args = changed;
+                s.def = def;
+
+                bool search = !s.complete || !narrower( s.def.hints, s.searched, dict );
+                status( s, timed( search ), search, options, std::cout );
+            }
+            else if ( command == "reload" )
+            {
+                s.excluded = wordcache::excludedWords( "exclude.txt", dict.symbols() );
+                status( s, timed( false ), false, options, std::cout );
             }
             else
-                hints.emplace_back( val, "", "" );
+            {
+                std::cerr << "commands are: exclude word.. | include word.. | hint n letters | reload | show [ n ] | quit" << std::endl;
+            }
         }
+    }
+}
+
+int main( int c, char *v[] )
+{
+    std::vector< std::string > args;
 
-        std::size_t numletters = std::count_if( letters.begin(), letters.end(), []( char & c ) { return c != ' '; } );
-        std::size_t numspaces = letters.size() - numletters;
+    searchoptions options;
+    std::string dictfile( "words.txt" );
+    std::string batchfile;
+    std::string cachefile;
+    bool interactive = false;
 
-        std::size_t sumsizes = std::accumulate( hints.begin(), hints.end(), std::size_t( 0 ),
-            []( std::size_t a, wordhint const & b )
+    for ( auto i = 1 ; i < c ; ++i )
+    {
+        std::string a( v[ i ] );
+        if ( a == "-v" )
+            options.verbose = true;
+        else if ( a == "--no-feasibility" )
+            options.feasibility = false;
+        else if ( a == "--constrained-first" )
+            options.constrainedFirst = true;
+        else if ( a == "--stats" )
+            options.stats = true;
+        else if ( a == "--first" )
+            options.maxSolutions = 1;
+        else if ( a == "--max-solutions" && i + 1 < c )
+            options.maxSolutions = std::strtoul( v[ ++i ], nullptr, 10 );
+        else if ( a == "--timeout" && i + 1 < c )
+            options.timeout = std::atof( v[ ++i ] );
+        else if ( a == "--strategy" && i + 1 < c )
+        {
+            std::string s( v[ ++i ] );
+            if ( s == "auto" )
+                options.method = strategy::automatic;
+            else if ( s == "cells" )
+                options.method = strategy::cells;
+            else if ( s == "words" )
+                options.method = strategy::words;
+            else
             {
-                return a + std::get< 0 >( b );
+                std::cerr << v[ 0 ] << ": unknown strategy \"" << s << "\", expected auto, cells or words" << std::endl;
+                exit( 1 );
             }
-        );
-
-        if ( sumsizes != numletters )
+        }
+        else if ( a == "--best-first" )
+            options.bestFirst = true;
+        else if ( a == "--max-states" && i + 1 < c )
+            options.maxStates = std::strtoul( v[ ++i ], nullptr, 10 );
+        else if ( a == "--session" )
+            interactive = true;
+        else if ( a == "--dict" && i + 1 < c )
+            dictfile = v[ ++i ];
+        else if ( a == "--batch" && i + 1 < c )
+            batchfile = v[ ++i ];
+        else if ( a == "--cache" && i + 1 < c )
+            cachefile = v[ ++i ];
+        else if ( a.compare( 0, 9, "--format=" ) == 0 || ( a == "--format" && i + 1 < c ) )
+        {
+            std::string f( a == "--format" ? v[ ++i ] : a.substr( 9 ) );
+            if ( f == "text" )
+                options.format = outputformat::text;
+            else if ( f == "jsonl" )
+                options.format = outputformat::jsonl;
+            else
+            {
+                std::cerr << v[ 0 ] << ": unknown format \"" << f << "\", expected text or jsonl" << std::endl;
+                exit( 1 );
+            }
+        }
+        else if ( a == "--compile-dict" )
         {
-            std::cerr << v[ 0 ] << ": sum of word sizes (" << sumsizes << ") does not match number of letters (" << numletters << ")" << std::endl;
-            if ( numspaces > 0 )
+            if ( i + 2 >= c )
+            {
+                std::cerr << "usage: " << v[ 0 ] << " --compile-dict words.txt words.bin" << std::endl;
+                exit( 1 );
+            }
+
+            if ( !dictionary::compile( v[ i + 1 ], v[ i + 2 ] ) )
             {
-                std::cerr << "You've supplied a partial grid, you maybe need to reduce your hints" << std::endl;
+                std::cerr << v[ 0 ] << ": unable to compile \"" << v[ i + 1 ] << "\" into \"" << v[ i + 2 ] << "\"" << std::endl;
+                exit( 1 );
             }
+            exit( 0 );
+        }
+        else
+        {
+            // mainly for windows but we need to remove any quotes from the hints
+            std::string::size_type quote;
+            while( (quote = a.find_first_of( "\"'" ) ) != std::string::npos )
+                a.replace( quote, 1, "" );
+            args.push_back( a );
+        }
+    }
+
+    if ( batchfile.empty() && args.size() < 4  )
+    {
+        std::cerr << "usage: " << v[ 0 ] << " [ -v ] [ --no-feasibility ] [ --constrained-first ] [ --stats ] [ --first | --max-solutions n ] [ --timeout seconds ] [ --strategy auto|cells|words ] [ --best-first [ --max-states n ] ] [ --dict words.txt|words.bin ] [ --cache file ] [ --format=text|jsonl ] [ --session ] height width letters wordsize [ wordsize .. ]" << std::endl;
+        std::cerr << "       " << v[ 0 ] << " [ -v ] [ --no-feasibility ] [ --constrained-first ] [ --stats ] [ --first | --max-solutions n ] [ --timeout seconds ] [ --strategy auto|cells|words ] [ --best-first [ --max-states n ] ] [ --dict words.txt|words.bin ] [ --cache file ] [ --format=text|jsonl ] --batch file|-" << std::endl;
+        std::cerr << "       " << v[ 0 ] << " --compile-dict words.txt words.bin" << std::endl;
+        std::cerr << "  Note. The sum of your words sizes much match ( height * width )" << std::endl;
+        exit( 1 );
+    }
+
+    // the puzzle is read in the word list's alphabet
+    dictionary dict( dictfile );
+
+    if ( !dict.good() )
+    {
+        std::cerr << v[ 0 ] << ": unable to load dictionary \"" << dictfile << "\"" << std::endl;
+        exit( 1 );
+    }
+
+    puzzledef def;
+
+    if ( batchfile.empty() )
+    {
+        std::string error;
+
+        if ( !parsePuzzle( args, dict.symbols(), def, error ) )
+        {
+            std::cerr << v[ 0 ] << ": " << error << std::endl;
             exit( 1 );
         }
     }
 
-    wordcache words( "words.txt", hints, letters );
+    if ( options.bestFirst && !dict.ranked() )
+        std::cerr << v[ 0 ] << ": \"" << dictfile << "\" doesn't say how common its words are, --best-first will find solutions in no particular order" << std::endl;
 
-    std::cout << "loaded " << words.size() << " words" << std::endl;
+    // the cache only has the solutions, not which is likeliest
+    if ( options.bestFirst && !cachefile.empty() )
+    {
+        std::cerr << v[ 0 ] << ": --cache isn't used with --best-first" << std::endl;
+        cachefile.clear();
+    }
+
+    std::unique_ptr< solutioncache > cache;
+    caching cached;
+
+    if ( !cachefile.empty() )
+    {
+        cache.reset( new solutioncache( cachefile ) );
 
-    std::cout << "hints : ";
+        if ( !cache->good() )
+        {
+            std::cerr << v[ 0 ] << ": unable to open solution cache \"" << cachefile << "\"" << std::endl;
+            exit( 1 );
+        }
+
+        cached.cache = cache.get();
+        cached.fingerprint = dict.fingerprint();
+        cached.excluded = wordcache::excludedWords( "exclude.txt", dict.symbols() );
+    }
+
+    if ( !batchfile.empty() )
+    {
+        auto excluded = cache ? cached.excluded : wordcache::excludedWords( "exclude.txt", dict.symbols() );
+
+        batch( batchfile, dict, excluded, options, cache ? &cached : nullptr );
+        return 0;
+    }
+
+    if ( interactive )
+    {
+        session( args, dict, options, cache ? &cached : nullptr );
+        return 0;
+    }
+
+    if ( cache && fromCache( def, dict.symbols(), cached, options, std::cout, true ) )
+        return 0;
+
+    auto const & hints = def.hints;
+    bool save = saving( cache ? &cached : nullptr, options );
+
+    // json lines are for other programs, they don't want the commentary
+    std::ostream null( nullptr );
+    std::ostream & chat = options.format == outputformat::jsonl ? null : std::cout;
+
+    wordcache words( dict, hints, def.letters, chat, save ? "" : "exclude.txt" );
+
+    chat << "loaded " << words.size() << " words" << std::endl;
+
+    chat << "hints : ";
     for ( auto const & h : hints )
     {
         if ( std::get< 1 >( h ).empty() )
-            std::cout << std::get< 0 >( h );
+            chat << std::get< 0 >( h );
         else
         {
-            std::cout << "\"" << std::get< 1 >( h ) << "\"";
+            chat << "\"" << dict.symbols().decode( std::get< 1 >( h ) ) << "\"";
             if ( std::get< 1 >( h ).size() != std::get< 0 >( h ) )
-                std::cout << "(" << std::get< 0 >( h ) << ")";
+                chat << "(" << std::get< 0 >( h ) << ")";
         }
-        std::cout << " ";
+        chat << " ";
     }
-    std::cout << std::endl;
-
-    puzzle p( words, verbose );
+    chat << std::endl;
 
-    p.search( grid( height, width, letters ), hints );
+    search( def, words, options, std::cout, true, save ? &cached : nullptr );
 }
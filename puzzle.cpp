@@ -12,202 +12,1276 @@
 #include <list>
 #include <tuple>
 #include <bitset>
+#include <cstring>
+#include <chrono>
+#include <queue>
 #include <tbb/tbb.h>
 
 #include "puzzle.hpp"
 
-puzzle::puzzle( wordcache const & words, bool verbose ) :
+template< std::size_t Bits, std::size_t Letters >
+puzzle< Bits, Letters >::puzzle( wordcache const & words, searchoptions const & options, std::ostream & out ) :
 	_words( words ),
-	_verbose( verbose )
+	_options( options ),
+	_out( out ),
+	_count( 0 ),
+	_wildcards( 0 ),
+	_prunedByLetters( 0 ),
+	_prunedByColumns( 0 ),
+	_prunedByHints( 0 ),
+	_nodes( 0 ),
+	_placed( 0 ),
+	_stopped( false ),
+	_timedOut( false ),
+	_outOfStates( false ),
+	_context( nullptr )
 {
+	_lines.set_capacity( 1024 );
 }
 
-void puzzle::search( grid const & letters, wordhints const & hints ) const throw()
+namespace
 {
-	letters.display();
+	// don't let the dead end table grow without bound on huge searches
+	std::size_t const maxDeadEnds = 1 << 22;
 
-	std::deque< found > f;
+	// hints with more words than this almost always have one that fits, so
+	// scanning them costs more than it prunes
+	std::size_t const maxConstrainedCandidates = 256;
 
-	search( letters, f, hints.begin() );
+	// remaining cells times remaining hints, below taskGrain a grid is
+	// searched without making tasks, from splitGrain the search from each
+	// start cell is split again at its second cell
+	std::size_t const taskGrain = 24;
+	std::size_t const splitGrain = 128;
+
+	// roughly how many cells a search from one start cell gets to for each
+	// letter of the word, used to guess what spreading out from the cells costs
+	std::size_t const cellsReached = 4;
 }
 
+searchcounts::searchcounts() :
+	nodes( 0 ),
+	placed( 0 ),
+	prunedByLetters( 0 ),
+	prunedByColumns( 0 ),
+	prunedByHints( 0 )
+{
+}
 
-void puzzle::search( grid const & letters, std::deque< found > const & f, wordhints::const_iterator const & hint ) const throw()
+searchstats::searchstats() :
+	pairingRejects( 0 ),
+	prefixRejects( 0 ),
+	hintRejects( 0 ),
+	notWords( 0 ),
+	matched( 0 ),
+	deadEndHits( 0 ),
+	wordGrids( 0 ),
+	wordsTraced( 0 ),
+	frontierRejects( 0 )
 {
-	char firstchar = 0;
+	nodes.fill( 0 );
+}
 
-	if ( !std::get< 1 >( *hint ).empty() )
-		firstchar = std::get< 1 >( *hint )[ 0 ];
+searchstats & searchstats::operator+=( searchstats const & o ) throw()
+{
+	for ( std::size_t i = 0 ; i < nodes.size() ; ++i )
+		nodes[ i ] += o.nodes[ i ];
+
+	pairingRejects += o.pairingRejects;
+	prefixRejects += o.prefixRejects;
+	hintRejects += o.hintRejects;
+	notWords += o.notWords;
+	matched += o.matched;
+	deadEndHits += o.deadEndHits;
+	wordGrids += o.wordGrids;
+	wordsTraced += o.wordsTraced;
+	frontierRejects += o.frontierRejects;
 
-	tbb::parallel_for< std::size_t >( 0, letters.size(), [firstchar, &hint, &f, &letters, this]( std::size_t pos )
+	return *this;
+}
+
+template< std::size_t Bits >
+std::size_t gridstatehash< Bits >::operator()( gridstate< Bits > const & s ) const throw()
+{
+	// FNV-1a over the letters and the hint
+	std::uint64_t h = 14695981039346656037ULL;
+
+	for ( auto const & c : s.letters )
+		h = ( h ^ static_cast< unsigned char >( c ) ) * 1099511628211ULL;
+
+	h = ( h ^ reinterpret_cast< std::uintptr_t >( s.hint ) ) * 1099511628211ULL;
+
+	return static_cast< std::size_t >( h );
+}
+
+template< std::size_t Bits >
+bool gridstatehash< Bits >::operator()( gridstate< Bits > const & a, gridstate< Bits > const & b ) const throw()
+{
+	return a.hint == b.hint && a.letters == b.letters;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+void puzzle< Bits, Letters >::search( grid< Bits, Letters > const & letters, wordhints const & hints ) const throw()
+{
+	_deadEnds.clear();
+	_threadCounts.clear();
+	_firstHint = hints.begin();
+	_lastHint = hints.end();
+	_stopped = false;
+	_timedOut = false;
+	_outOfStates = false;
+	_count = 0;
+	_solutions.clear();
+	_wildcards = letters.wild().count();
+
+	for ( auto & s : _shards )
 	{
-		auto thischar = letters[ pos ];
+		s.seen.clear();
+		s.solutions.clear();
+	}
 
-		if ( thischar != ' ' && ( firstchar == 0 || ( firstchar != 0 && thischar == firstchar ) ) )
+	// nothing to write to, don't bother formatting anything
+	if ( _out.rdbuf() != nullptr )
+	{
+		_writer = std::thread( [ this ]()
 		{
-			std::string word;
-			wordpath path;
+			std::string line;
 
-			search( letters, pos, path, word, f, hint );
-		}
-	} );
+			for ( ;; )
+			{
+				_lines.pop( line );
+
+				// an empty line is the search saying it's done
+				if ( line.empty() )
+					break;
+
+				_out << line;
+
+				// flush once we've caught up, not every line
+				if ( _lines.empty() )
+					_out.flush();
+			}
+
+			_out.flush();
+		} );
+	}
+
+	if ( _options.timeout > 0 )
+		_deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast< std::chrono::steady_clock::duration >( std::chrono::duration< double >( _options.timeout ) );
+
+	// the searches started for the words after the first are bound to
+	// this context, so cancelling it stops all of them
+	tbb::task_group_context context;
+	_context = &context;
+
+	if ( _options.bestFirst )
+		searchBest( letters );
+	else if ( !_options.stats )
+		search< false >( letters, nullptr, hints.begin() );
+	else
+	{
+		_threadStats.clear();
+		_startTime = std::vector< std::atomic< std::uint64_t > >( letters.size() );
+
+		search< true >( letters, nullptr, hints.begin() );
+
+		_stats = _threadStats.combine( []( searchstats a, searchstats const & b ) { return a += b; } );
+	}
+
+	_context = nullptr;
+
+	_prunedByLetters = 0;
+	_prunedByColumns = 0;
+	_prunedByHints = 0;
+	_nodes = 0;
+	_placed = 0;
+
+	for ( auto const & t : _threadCounts )
+	{
+		_prunedByLetters += t.prunedByLetters;
+		_prunedByColumns += t.prunedByColumns;
+		_prunedByHints += t.prunedByHints;
+		_nodes += t.nodes;
+		_placed += t.placed;
+	}
+
+	if ( _writer.joinable() )
+	{
+		_lines.push( std::string() );
+		_writer.join();
+	}
+
+	for ( auto & s : _shards )
+		_solutions.insert( _solutions.end(), s.solutions.begin(), s.solutions.end() );
+
+	std::sort( _solutions.begin(), _solutions.end() );
+}
+
+template< std::size_t Bits, std::size_t Letters >
+void puzzle< Bits, Letters >::writeStats( std::ostream & out ) const throw()
+{
+	std::size_t depth = _lastHint - _firstHint;
+
+	out << "{ \"nodes\": " << _nodes << ", \"nodes_by_hint\": [ ";
+	for ( std::size_t i = 0 ; i < depth ; ++i )
+		out << ( i ? ", " : "" ) << _stats.nodes[ i ];
+	out << " ]";
+
+	out << ", \"pairing_rejects\": " << _stats.pairingRejects
+		<< ", \"prefix_rejects\": " << _stats.prefixRejects
+		<< ", \"hint_rejects\": " << _stats.hintRejects
+		<< ", \"not_words\": " << _stats.notWords
+		<< ", \"words_matched\": " << _stats.matched
+		<< ", \"dead_end_hits\": " << _stats.deadEndHits
+		<< ", \"word_grids\": " << _stats.wordGrids
+		<< ", \"words_traced\": " << _stats.wordsTraced
+		<< ", \"frontier_rejects\": " << _stats.frontierRejects
+		<< ", \"pruned_by_letters\": " << _prunedByLetters
+		<< ", \"pruned_by_columns\": " << _prunedByColumns
+		<< ", \"pruned_by_hints\": " << _prunedByHints
+		<< ", \"solutions\": " << _solutions.size();
+
+	out << ", \"start_ms\": { ";
+	bool first = true;
+	for ( std::size_t pos = 0 ; pos < _startTime.size() ; ++pos )
+	{
+		if ( _startTime[ pos ] == 0 )
+			continue;
+
+		out << ( first ? "" : ", " ) << "\"" << pos << "\": " << _startTime[ pos ] / 1e6;
+		first = false;
+	}
+	out << " } }" << std::endl;
 }
 
-bool puzzle::isValidLocation( grid const & letters, std::size_t pos, wordpath const & path, char current_char ) const throw()
+
+template< std::size_t Bits, std::size_t Letters >
+template< bool Stats >
+bool puzzle< Bits, Letters >::search( grid< Bits, Letters > const & letters, found< Bits, Letters > const * f, wordhints::const_iterator const & hint ) const throw()
 {
-	// have we already been here
-	if ( path.test( pos ) == true )	
+	if ( _stopped.load( std::memory_order_relaxed ) )
 		return false;
 
-	char proposed_char = letters[ pos ];
+	gridstate< Bits > state;
+	state.letters = letters.letters();
+	state.hint = &*hint;
+
+	// we've been here before by another route and found nothing
+	if ( _deadEnds.count( state ) != 0 )
+	{
+		if ( Stats )
+			++_threadStats.local().deadEndHits;
+		return false;
+	}
 
-	if ( proposed_char == ' ' )
+	if ( _options.feasibility && !feasible( letters, hint ) )
 		return false;
 
-	return _words.isValidCharPairing( current_char, proposed_char );
+	if ( _options.constrainedFirst && !hintsCanBeMet( letters, hint ) )
+		return false;
+
+	std::atomic< bool > solved( false );
+
+	if ( wordDriven( letters, hint ) )
+	{
+		searchWords< Stats >( letters, f, hint, solved );
+
+		if ( !solved && !_stopped && _deadEnds.size() < maxDeadEnds )
+			_deadEnds.insert( state );
+
+		return solved;
+	}
+
+	auto follows = pairings( letters );
+
+	path starts = this->starts( letters, hint );
+
+	cursor< Bits > c;
+	c.length = 0;
+	c.solved = &solved;
+
+	// how finely the work here is split into tasks depends on how much
+	// of it there is. the small grids near the end of a solution are
+	// quicker searched by the thread that's already here, the big ones
+	// are split below their first cell as well so that one busy start
+	// cell can't leave the other threads with nothing to do
+	std::size_t grain = letters.occupied().count() * ( _lastHint - hint );
+
+	c.splitDepth = grain >= splitGrain ? 1 : 0;
+
+	if ( grain < taskGrain )
+	{
+		c.group = nullptr;
+
+		while ( starts.any() )
+		{
+			std::size_t pos = starts.lowest();
+			starts.reset( pos );
+
+			c.start = pos;
+			run< Stats >( letters, pos, c, _words.trie( hint - _firstHint ).root(), follows, f, hint );
+		}
+	}
+	else
+	{
+		// the top level runs in the context search() can cancel, the
+		// groups below are bound to it through the tasks they run in
+		tbb::task_group_context context;
+		tbb::task_group group( f == nullptr ? *_context : context );
+
+		c.group = &group;
+
+		while ( starts.any() )
+		{
+			std::size_t pos = starts.lowest();
+			starts.reset( pos );
+
+			c.start = pos;
+			spawn< Stats >( letters, pos, c, _words.trie( hint - _firstHint ).root(), follows, f, hint );
+		}
+
+		group.wait();
+	}
+
+	// a search that was stopped hasn't seen everything below here
+	if ( !solved && !_stopped && _deadEnds.size() < maxDeadEnds )
+		_deadEnds.insert( state );
+
+	return solved;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+template< bool Stats >
+void puzzle< Bits, Letters >::spawn( grid< Bits, Letters > const & letters, std::size_t pos, cursor< Bits > const & c, wordtrie::node node, std::array< path, Letters > const & follows, found< Bits, Letters > const * f, wordhints::const_iterator hint ) const throw()
+{
+	// everything referred to lives in the search() that waits for the group
+	c.group->run( [ this, &letters, pos, c, node, &follows, f, hint ]()
+	{
+		run< Stats >( letters, pos, c, node, follows, f, hint );
+	} );
+}
+
+template< std::size_t Bits, std::size_t Letters >
+template< bool Stats >
+void puzzle< Bits, Letters >::run( grid< Bits, Letters > const & letters, std::size_t pos, cursor< Bits > c, wordtrie::node node, std::array< path, Letters > const & follows, found< Bits, Letters > const * f, wordhints::const_iterator const & hint ) const throw()
+{
+	// each task counts into the thread it runs on
+	c.nodes = 0;
+	c.placed = 0;
+	c.stats = Stats ? &_threadStats.local() : nullptr;
+
+	std::chrono::steady_clock::time_point start;
+	if ( Stats )
+		start = std::chrono::steady_clock::now();
+
+	search< Stats >( letters, pos, c, node, follows, f, hint );
+
+	if ( Stats && f == nullptr )
+		_startTime[ c.start ] += std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - start ).count();
+
+	auto & local = _threadCounts.local();
+	local.nodes += c.nodes;
+	local.placed += c.placed;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+std::array< typename puzzle< Bits, Letters >::path, Letters > puzzle< Bits, Letters >::pairings( grid< Bits, Letters > const & letters ) const throw()
+{
+	std::array< path, Letters > follows;
+	std::size_t n = _words.symbols().size();
+
+	auto near = nearWild( letters );
+
+	for ( std::size_t i = 0 ; i < n ; ++i )
+	{
+		char c1 = letterAt( i );
+
+		if ( letters.cells( c1 ).none() )
+			continue;
+
+		for ( std::size_t j = 0 ; j < n ; ++j )
+		{
+			char c2 = letterAt( j );
+
+			if ( letters.cells( c2 ).none() || !_words.isValidCharPairing( c1, c2 ) )
+				continue;
+
+			auto reach = _words.pairingReach( c1, c2 );
+
+			if ( reach >= wildSteps )
+				follows[ i ] |= letters.cells( c2 );
+			else
+				follows[ i ] |= letters.cells( c2 ) & near[ reach ];
+		}
+	}
+
+	return follows;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+std::array< typename puzzle< Bits, Letters >::path, puzzle< Bits, Letters >::wildSteps > puzzle< Bits, Letters >::nearWild( grid< Bits, Letters > const & letters ) const throw()
+{
+	std::array< path, wildSteps > near;
+
+	if ( letters.wild().none() )
+		return near;
+
+	near[ 0 ] = letters.wild();
+
+	for ( std::size_t steps = 1 ; steps < wildSteps ; ++steps )
+		near[ steps ] = near[ steps - 1 ] | ( letters.around( near[ steps - 1 ] ) & letters.occupied() );
+
+	return near;
 }
 
-void puzzle::addSolution( std::deque< found > const & fl ) const throw()
+template< std::size_t Bits, std::size_t Letters >
+typename puzzle< Bits, Letters >::path puzzle< Bits, Letters >::starts( grid< Bits, Letters > const & letters, wordhints::const_iterator const & hint ) const throw()
 {
-	std::stringstream ss;
-	for ( auto const & f : fl )
-		ss << std::get< 0 >( f ) << " ";
+	// a word starts on the first letter of one of the hint's words
+	auto const & first = _words.firstLetters( hint - _firstHint );
+	auto const & reach = _words.firstReach( hint - _firstHint );
+	auto near = nearWild( letters );
+
+	path starts;
+
+	for ( std::size_t c = 0 ; c < _words.symbols().size() ; ++c )
+	{
+		if ( first[ c ] == 0 )
+			continue;
+
+		if ( reach[ c ] >= wildSteps )
+			starts |= letters.cells( letterAt( c ) );
+		else
+			starts |= letters.cells( letterAt( c ) ) & near[ reach[ c ] ];
+	}
 
-	std::lock_guard< std::mutex > g( _solutionLock );
-	auto iret = _solutions.insert( ss.str() );
+	// and no further from each letter the hint gives than that letter
+	// is from the start of the word
+	auto const & pattern = std::get< 1 >( *hint );
 
-	if ( iret.second )
+	for ( std::size_t i = 1 ; i < pattern.size() && starts.any() ; ++i )
 	{
-		std::cout << *iret.first << std::endl;
+		if ( pattern[ i ] == '.' )
+			continue;
+
+		path reach = letters.cells( pattern[ i ] );
+
+		for ( std::size_t step = 0 ; step < i ; ++step )
+			reach |= letters.around( reach ) & letters.occupied();
+
+		starts &= reach;
+	}
+
+	return starts;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+bool puzzle< Bits, Letters >::feasible( grid< Bits, Letters > const & letters, wordhints::const_iterator const & hint ) const throw()
+{
+	// every letter left has to fit into one of the words left
+	auto have = letters.counts();
+	auto const & budget = _words.letterBudget( hint - _firstHint );
+
+	bool over = false;
+
+	for ( std::size_t c = 0 ; c < Letters ; ++c )
+		over |= have[ c ] > budget[ c ];
+
+	if ( over )
+	{
+		++_threadCounts.local().prunedByLetters;
+		return false;
+	}
+
+	// and each run of columns has to be made of whole words
+	std::array< std::size_t, Bits > runs;
+	auto n = letters.columnRuns( runs );
+
+	if ( n > 1 )
+	{
+		// the totals that some selection of the words left can add up to
+		std::bitset< Bits + 1 > sums;
+		sums.set( 0 );
+
+		for ( auto h = hint ; h != _lastHint ; ++h )
+			sums |= sums << std::get< 0 >( *h );
 
-		if ( _verbose )
+		for ( std::size_t r = 0 ; r < n ; ++r )
 		{
-			for ( auto const & f : fl )
+			if ( !sums.test( runs[ r ] ) )
 			{
-				std::get< 1 >( f ).display( std::get< 0 >( f ), std::get< 2 >( f ) );
-				std::cout << std::endl;
+				++_threadCounts.local().prunedByColumns;
+				return false;
 			}
 		}
 	}
+
+	return true;
 }
 
-void puzzle::search( grid const & letters, std::size_t pos, wordpath path, std::string word, std::deque< found > const & f, wordhints::const_iterator const & hint ) const throw()
+template< std::size_t Bits, std::size_t Letters >
+bool puzzle< Bits, Letters >::hintsCanBeMet( grid< Bits, Letters > const & letters, wordhints::const_iterator const & hint ) const throw()
 {
-	path.set( pos );
+	// the words still have to be placed in hint order because of the way the
+	// letters fall, but every hint left needs at least one of its words to be
+	// made from the letters still here. the hints with the fewest ways to
+	// start in this grid are the most likely to have run out so check those first
+	auto have = letters.counts();
+	auto wild = letters.wild().count();
 
-	char newchar = letters[ pos ];
+	std::size_t symbols = _words.symbols().size();
 
-	word += newchar;
+	std::array< std::size_t, Letters > starts;
+	for ( std::size_t c = 0 ; c < symbols ; ++c )
+		starts[ c ] = letters.cells( letterAt( c ) ).count();
 
-	auto word_size_at_this_depth = std::get< 0 >( *hint );
+	std::array< std::pair< std::size_t, std::size_t >, Bits > order;
+	std::size_t n = 0;
 
-	if ( word.size() == word_size_at_this_depth )
+	for ( auto h = hint ; h != _lastHint ; ++h )
 	{
-		bool backwards = false;
+		std::size_t index = h - _firstHint;
+		auto const & first = _words.firstLetters( index );
+
+		std::size_t estimate = 0;
+		for ( std::size_t c = 0 ; c < symbols ; ++c )
+			estimate += first[ c ] * starts[ c ];
+
+		if ( estimate == 0 )
+		{
+			++_threadCounts.local().prunedByHints;	// no word for this hint can even start here
+			return false;
+		}
+
+		order[ n++ ] = std::make_pair( estimate, index );
+	}
+
+	std::sort( order.begin(), order.begin() + n );
+
+	for ( std::size_t i = 0 ; i < n ; ++i )
+	{
+		auto const & candidates = _words.candidates( order[ i ].second );
+
+		if ( candidates.size() > maxConstrainedCandidates )
+			continue;
+
+		bool fits = std::any_of( candidates.begin(), candidates.end(), [ &have, wild ]( lettercounts const & w )
+		{
+			return shortfall< Letters >( w, have ) <= wild;
+		} );
+
+		if ( !fits )
+		{
+			++_threadCounts.local().prunedByHints;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+void puzzle< Bits, Letters >::addSolution( found< Bits, Letters > const * f ) const throw()
+{
+	// the records run from the last word back to the first
+	found< Bits, Letters > const * words[ Bits ];
+	std::size_t count = 0;
+
+	for ( ; f != nullptr ; f = f->previous )
+		words[ count++ ] = f;
+
+	char buf[ Bits * 2 + 1 ];
+	char * p = buf;
 
-		if ( isMatch( *hint, word, backwards ) )
+	for ( std::size_t i = count ; i > 0 ; --i )
+	{
+		for ( char const * w = words[ i - 1 ]->word ; *w ; ++w )
+			*p++ = *w;
+		*p++ = ' ';
+	}
+
+	std::uint64_t h = dictionary::hash( buf, p - buf );
+	auto & s = _shards[ h % shards ];
+
+	{
+		std::lock_guard< std::mutex > g( s.lock );
+
+		if ( !s.seen.insert( h ).second )
+			return;
+
+		// other threads can still be finishing off solutions once we've stopped
+		std::size_t n = _count++;
+
+		if ( _options.maxSolutions != 0 && n >= _options.maxSolutions )
+			return;
+
+		s.solutions.emplace_back( buf, p - buf );
+
+		if ( _options.maxSolutions != 0 && n + 1 == _options.maxSolutions )
+			stop( false );
+	}
+
+	if ( _writer.joinable() )
+		write( words, count, buf, p - buf );
+}
+
+template< std::size_t Bits, std::size_t Letters >
+void puzzle< Bits, Letters >::write( found< Bits, Letters > const * const * words, std::size_t count, char const * text, std::size_t length ) const throw()
+{
+	std::ostringstream line;
+	auto const & symbols = _words.symbols();
+
+	// what each cell we couldn't read turned out to be, in the order they
+	// were given. they carry their number with them as the letters fall
+	std::array< char, grid< Bits, Letters >::maxWildcards > resolved;
+
+	for ( std::size_t i = 0 ; i < count && _wildcards != 0 ; ++i )
+	{
+		auto const & w = *words[ i ];
+
+		for ( std::size_t l = 0 ; w.word[ l ] ; ++l )
 		{
-			if ( backwards )
-				std::reverse( word.begin(), word.end() );
+			char ch = ( *w.letters )[ w.cells[ l ] ];
 
-			std::deque< found > newfound( f );
+			if ( grid< Bits, Letters >::isWild( ch ) )
+				resolved[ grid< Bits, Letters >::wildIndex( ch ) ] = w.word[ l ];
+		}
+	}
+
+	if ( _options.format == outputformat::jsonl )
+	{
+		// cells are given as [ row, column ] in the grid the word was
+		// taken from, i.e. after the words before it have gone and the
+		// letters above them have dropped
+		line << "{ \"solution\": [ ";
+		for ( std::size_t i = count ; i > 0 ; --i )
+			line << ( i < count ? ", " : "" ) << "\"" << symbols.decode( words[ i - 1 ]->word, std::strlen( words[ i - 1 ]->word ) ) << "\"";
+		line << " ], \"paths\": [ ";
+		for ( std::size_t i = count ; i > 0 ; --i )
+		{
+			auto const & w = *words[ i - 1 ];
+			std::size_t width = w.letters->width();
 
-			newfound.emplace_back( word, letters, path );
+			line << ( i < count ? ", " : "" ) << "[ ";
+			for ( std::size_t l = 0 ; w.word[ l ] ; ++l )
+				line << ( l ? ", " : "" ) << "[ " << w.cells[ l ] / width << ", " << w.cells[ l ] % width << " ]";
+			line << " ]";
+		}
+		line << " ]";
+		if ( _wildcards != 0 )
+		{
+			line << ", \"wildcards\": [ ";
+			for ( std::size_t k = 0 ; k < _wildcards ; ++k )
+				line << ( k ? ", " : "" ) << "\"" << symbols.decode( &resolved[ k ], 1 ) << "\"";
+			line << " ]";
+		}
+		line << " }" << std::endl;
+	}
+	else
+	{
+		line << symbols.decode( text, length ) << std::endl;
 
-			grid newgrid = letters.remove( path );
+		if ( _wildcards != 0 )
+		{
+			line << "  ? =";
+			for ( std::size_t k = 0 ; k < _wildcards ; ++k )
+				line << " " << symbols.decode( &resolved[ k ], 1 );
+			line << std::endl;
+		}
 
-			if ( newgrid.empty() )
+		if ( _options.verbose )
+		{
+			for ( std::size_t i = count ; i > 0 ; --i )
 			{
-				addSolution( newfound );
+				words[ i - 1 ]->letters->display( line, symbols, words[ i - 1 ]->word, words[ i - 1 ]->path );
+				line << std::endl;
 			}
-			else
+		}
+	}
+
+	_lines.push( line.str() );
+}
+
+template< std::size_t Bits, std::size_t Letters >
+void puzzle< Bits, Letters >::stop( bool timedOut ) const throw()
+{
+	if ( timedOut )
+		_timedOut = true;
+
+	_stopped = true;
+	_context->cancel_group_execution();
+}
+
+template< std::size_t Bits, std::size_t Letters >
+template< bool Stats >
+void puzzle< Bits, Letters >::search( grid< Bits, Letters > const & letters, std::size_t pos, cursor< Bits > & c, wordtrie::node node, std::array< path, Letters > const & follows, found< Bits, Letters > const * f, wordhints::const_iterator const & hint ) const throw()
+{
+	if ( halted( c ) )
+		return;
+
+	std::size_t first = letterIndex( letters[ pos ] );
+	std::size_t last = first;
+
+	// a cell we couldn't read is whichever letter a word here can go on
+	// with, so it only branches as far as the prefix tree lets it
+	if ( grid< Bits, Letters >::isWild( letters[ pos ] ) )
+	{
+		first = 0;
+		last = _words.symbols().size() - 1;
+	}
+
+	auto const & trie = _words.trie( hint - _firstHint );
+
+	for ( std::size_t l = first ; l <= last ; ++l )
+	{
+		if ( first == last || trie.next( node, letterAt( l ) ) != wordtrie::dead )
+			visit< Stats >( letters, pos, c, node, follows, f, hint, letterAt( l ) );
+	}
+}
+
+template< std::size_t Bits, std::size_t Letters >
+template< bool Stats >
+void puzzle< Bits, Letters >::visit( grid< Bits, Letters > const & letters, std::size_t pos, cursor< Bits > & c, wordtrie::node node, std::array< path, Letters > const & follows, found< Bits, Letters > const * f, wordhints::const_iterator const & hint, char newchar ) const throw()
+{
+	c.path.set( pos );
+	c.cells[ c.length ] = static_cast< std::uint8_t >( pos );
+	c.word[ c.length++ ] = newchar;
+	++c.nodes;
+
+	if ( Stats )
+		++c.stats->nodes[ hint - _firstHint ];
+
+	// step down the hint's prefix tree, if we fall off it then no word
+	// that could answer the hint starts with the letters we've got so far
+	auto const & trie = _words.trie( hint - _firstHint );
+
+	node = trie.next( node, newchar );
+
+	auto word_size_at_this_depth = std::get< 0 >( *hint );
+
+	if ( c.length == word_size_at_this_depth )
+	{
+		bool backwards = false;
+
+		if ( isMatch( *hint, c, trie.isWord( node ), backwards ) )
+			place< Stats >( letters, c, f, hint, backwards );
+		else if ( Stats )
+			++c.stats->notWords;
+	}
+	else
+	{
+		// the tree only holds words matching the hint, whether it gives
+		// some of the letters or the whole word
+		if ( node != wordtrie::dead )
+		{
+			// the cells we can move to next are the unvisited neighbours
+			// holding a letter that may follow the one we're on
+			auto next = letters.neighbours( pos ) & follows[ letterIndex( newchar ) ] & ~c.path;
+
+			if ( Stats )
+				c.stats->pairingRejects += ( letters.neighbours( pos ) & letters.occupied() & ~c.path ).count() - next.count();
+
+			while ( next.any() )
 			{
-				search( newgrid, newfound, hint + 1 );
+				std::size_t newpos = next.lowest();
+				next.reset( newpos );
+
+				if ( c.length <= c.splitDepth && c.group != nullptr )
+					spawn< Stats >( letters, newpos, c, node, follows, f, hint );
+				else
+					search< Stats >( letters, newpos, c, node, follows, f, hint );
 			}
 		}
+		else if ( Stats )
+		{
+			auto const & word_at_this_depth = std::get< 1 >( *hint );
+
+			if ( !fitsHint( word_at_this_depth, c.word, c.length ) )
+				++c.stats->hintRejects;
+			else
+				++c.stats->prefixRejects;
+		}
+	}
+
+	c.path.reset( pos );
+	--c.length;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+template< bool Stats >
+void puzzle< Bits, Letters >::place( grid< Bits, Letters > const & letters, cursor< Bits > & c, found< Bits, Letters > const * f, wordhints::const_iterator const & hint, bool backwards ) const throw()
+{
+	found< Bits, Letters > record;
+
+	++c.placed;
+
+	if ( Stats )
+		++c.stats->matched;
+
+	std::copy( c.word, c.word + c.length, record.word );
+	std::copy( c.cells, c.cells + c.length, record.cells );
+	record.word[ c.length ] = 0;
+
+	if ( backwards )
+	{
+		std::reverse( record.word, record.word + c.length );
+		std::reverse( record.cells, record.cells + c.length );
+	}
+
+	record.letters = &letters;
+	record.path = c.path;
+	record.previous = f;
+
+	grid< Bits, Letters > newgrid = letters.remove( c.path );
+
+	if ( newgrid.empty() )
+	{
+		addSolution( &record );
+		*c.solved = true;
+	}
+	else if ( search< Stats >( newgrid, &record, hint + 1 ) )
+	{
+		*c.solved = true;
+	}
+}
+
+template< std::size_t Bits, std::size_t Letters >
+bool puzzle< Bits, Letters >::halted( cursor< Bits > const & c ) const throw()
+{
+	if ( _stopped.load( std::memory_order_relaxed ) )
+		return true;
+
+	// looking at the clock every cell would cost more than the search
+	if ( _options.timeout > 0 && ( c.nodes & 4095 ) == 0 && std::chrono::steady_clock::now() > _deadline )
+	{
+		stop( true );
+		return true;
+	}
+
+	return false;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+bool puzzle< Bits, Letters >::wordDriven( grid< Bits, Letters > const & letters, wordhints::const_iterator const & hint ) const throw()
+{
+	if ( _options.method != strategy::automatic )
+		return _options.method == strategy::words;
+
+	std::size_t index = hint - _firstHint;
+	std::size_t length = std::get< 0 >( *hint );
+
+	// tracing a word costs a frontier step per letter. spreading out from
+	// the cells holding a first letter costs about a step for every prefix
+	// of the hint's words that the grid can spell, which is at most the
+	// size of the prefix tree and usually a lot less as the grid runs out
+	// of ways to go long before the tree runs out of words
+	auto const & first = _words.firstLetters( index );
+
+	std::size_t starts = 0;
+	for ( std::size_t c = 0 ; c < _words.symbols().size() ; ++c )
+	{
+		if ( first[ c ] != 0 )
+			starts += letters.cells( letterAt( c ) ).count();
+	}
+
+	std::size_t wordCost = _words.candidates( index ).size() * length;
+	std::size_t cellCost = starts * std::min< std::size_t >( _words.trie( index ).size(), cellsReached * length );
+
+	return wordCost < cellCost;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+template< bool Stats >
+void puzzle< Bits, Letters >::searchWords( grid< Bits, Letters > const & letters, found< Bits, Letters > const * f, wordhints::const_iterator const & hint, std::atomic< bool > & solved ) const throw()
+{
+	std::size_t index = hint - _firstHint;
+
+	cursor< Bits > c;
+	c.length = 0;
+	c.solved = &solved;
+	c.nodes = 0;
+	c.placed = 0;
+	c.stats = Stats ? &_threadStats.local() : nullptr;
+	c.group = nullptr;
+	c.splitDepth = 0;
+	c.start = 0;
+
+	if ( Stats )
+		++c.stats->wordGrids;
+
+	auto const & words = _words.candidateWords( index );
+	auto const & counts = _words.candidates( index );
+	auto have = letters.counts();
+	auto wild = letters.wild().count();
+
+	for ( std::size_t w = 0 ; w < words.size() && !halted( c ) ; ++w )
+	{
+		if ( shortfall< Letters >( counts[ w ], have ) > wild )
+			continue;
+
+		char const * word = words[ w ];
+
+		if ( Stats )
+			++c.stats->wordsTraced;
+
+		// every cell the word could have reached each letter at. letting
+		// the path go back over its own cells makes this a superset of
+		// where it really gets to, but it's a handful of bit operations a
+		// letter and most words fall out of the grid within a few letters
+		path reach = letters.cells( word[ 0 ] );
+
+		for ( std::size_t i = 1 ; word[ i ] != 0 && reach.any() ; ++i )
+			reach = letters.around( reach ) & letters.cells( word[ i ] );
+
+		if ( reach.none() )
+		{
+			if ( Stats )
+				++c.stats->frontierRejects;
+			continue;
+		}
+
+		// the word might be here, follow every real path it has
+		for ( path starts( letters.cells( word[ 0 ] ) ) ; starts.any() ; )
+		{
+			std::size_t pos = starts.lowest();
+			starts.reset( pos );
+
+			trace< Stats >( letters, pos, c, word, f, hint );
+		}
 	}
+
+	auto & local = _threadCounts.local();
+	local.nodes += c.nodes;
+	local.placed += c.placed;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+template< bool Stats >
+void puzzle< Bits, Letters >::trace( grid< Bits, Letters > const & letters, std::size_t pos, cursor< Bits > & c, char const * word, found< Bits, Letters > const * f, wordhints::const_iterator const & hint ) const throw()
+{
+	if ( halted( c ) )
+		return;
+
+	// an unknown cell takes the letter the word needs
+	c.path.set( pos );
+	c.cells[ c.length ] = static_cast< std::uint8_t >( pos );
+	c.word[ c.length ] = word[ c.length ];
+	++c.length;
+	++c.nodes;
+
+	if ( Stats )
+		++c.stats->nodes[ hint - _firstHint ];
+
+	if ( word[ c.length ] == 0 )
+		place< Stats >( letters, c, f, hint, false );
 	else
 	{
-		auto const & word_at_this_depth = std::get< 1 >( *hint );
+		auto next = letters.neighbours( pos ) & letters.cells( word[ c.length ] ) & ~c.path;
+
+		while ( next.any() )
+		{
+			std::size_t newpos = next.lowest();
+			next.reset( newpos );
+
+			trace< Stats >( letters, newpos, c, word, f, hint );
+		}
+	}
+
+	c.path.reset( pos );
+	--c.length;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+void puzzle< Bits, Letters >::searchBest( grid< Bits, Letters > const & letters ) const throw()
+{
+	// a solution's cost is the sum of its words' costs, the bound on a
+	// partial one is its cost so far plus the least each hint left could
+	// add. with the bound never more than the cost of any solution it
+	// leads to, the first solution taken off the queue is the cheapest and
+	// the rest follow in order.
+	//
+	// a partial solution goes on the queue bounded by the cheapest word of
+	// each hint left, which costs nothing to work out but is usually a
+	// word the grid no longer has the letters for. when it comes to the
+	// front it's bounded again by the cheapest words the letters left can
+	// still make, and goes back if that puts it behind something else
+	struct partial
+	{
+		std::uint64_t	bound;
+		std::uint64_t	cost;
+		std::size_t		placed;		// how many hints have their word
+		std::size_t		last;		// the state of the word placed last
+		bool			fitted;		// bounded by the words that fit
+	};
+
+	// each word placed is kept as the cells it took, where its letters are
+	// in spelt and the state it carried on from. the grid it leaves is
+	// worked out again from the starting grid when it's needed, keeping a
+	// grid for every state would take many times the room
+	struct state
+	{
+		path			removed;
+		std::size_t		previous;
+		std::size_t		letters;
+	};
+
+	std::size_t const none = ~std::size_t( 0 );		// the state before any word is placed
+
+	std::size_t hints = _lastHint - _firstHint;
+	std::vector< std::uint64_t > least( hints + 1, 0 );
+
+	// each hint's words, cheapest first
+	std::vector< std::vector< std::uint32_t > > byCost( hints );
+
+	for ( std::size_t i = hints ; i-- > 0 ; )
+	{
+		auto const & costs = _words.costs( i );
+
+		byCost[ i ].resize( costs.size() );
+		std::iota( byCost[ i ].begin(), byCost[ i ].end(), 0 );
+		std::stable_sort( byCost[ i ].begin(), byCost[ i ].end(), [ &costs ]( std::uint32_t a, std::uint32_t b ) { return costs[ a ] < costs[ b ]; } );
+
+		least[ i ] = least[ i + 1 ] + ( costs.empty() ? 0 : costs[ byCost[ i ].front() ] );
+	}
+
+	// the least the hints from one on can add with the letters in a grid,
+	// false if one of them has no word left at all
+	auto fitted = [ this, hints, &byCost ]( grid< Bits, Letters > const & letters, std::size_t from, std::uint64_t & total )
+	{
+		auto have = letters.counts();
+		auto wild = letters.wild().count();
+
+		total = 0;
+
+		for ( std::size_t i = from ; i < hints ; ++i )
+		{
+			auto const & candidates = _words.candidates( i );
+
+			auto fits = std::find_if( byCost[ i ].begin(), byCost[ i ].end(), [ &candidates, &have, wild ]( std::uint32_t w )
+			{
+				return shortfall< Letters >( candidates[ w ], have ) <= wild;
+			} );
+
+			if ( fits == byCost[ i ].end() )
+				return false;
+
+			total += _words.costs( i )[ *fits ];
+		}
+
+		return true;
+	};
+
+	// ties go to the partial solution with more words, so a word list
+	// without frequencies, where everything costs the same, goes depth first
+	auto worse = []( partial const & a, partial const & b )
+	{
+		return a.bound != b.bound ? a.bound > b.bound : a.placed < b.placed;
+	};
+
+	std::priority_queue< partial, std::vector< partial >, decltype( worse ) > queue( worse );
+
+	// the words of every partial solution, the cells of each in the order
+	// they're spelt followed by its letters
+	std::vector< state > states;
+	std::vector< char > spelt;
+
+	// the grids after each word placed on the way to a state, grids[ 0 ]
+	// being the one the search started from
+	std::vector< std::size_t > chain;
+	std::vector< grid< Bits, Letters > > grids;
+
+	auto replay = [ &letters, &states, &chain, &grids, none ]( std::size_t last )
+	{
+		chain.clear();
+		for ( std::size_t s = last ; s != none ; s = states[ s ].previous )
+			chain.push_back( s );
+
+		grids.clear();
+		grids.push_back( letters );
+		for ( auto s = chain.rbegin() ; s != chain.rend() ; ++s )
+			grids.push_back( grids.back().remove( states[ *s ].removed ) );
+	};
+
+	queue.push( partial{ least[ 0 ], 0, 0, none, false } );
+
+	cursor< Bits > c;
+	c.length = 0;
+	c.solved = nullptr;
+	c.nodes = 0;
+	c.placed = 0;
+	c.stats = nullptr;
+	c.group = nullptr;
+	c.splitDepth = 0;
+	c.start = 0;
+
+	while ( !queue.empty() && !halted( c ) )
+	{
+		partial p = queue.top();
+		queue.pop();
 
-		if ( ( word_at_this_depth.empty() && _words.canBeginWith( word ) ) ||
-			( !word_at_this_depth.empty() && std::strncmp( word_at_this_depth.c_str(), word.c_str(), std::min( word_at_this_depth.size(), word.size() ) ) == 0 ) )
+		replay( p.last );
+
+		if ( p.placed == hints )
 		{
-			std::size_t newpos;
+			std::vector< found< Bits, Letters > > words( hints );
 
-			if ( pos >= letters.width() )	// y > 0
+			for ( std::size_t i = 0 ; i < hints ; ++i )
 			{
-				if ( ( pos % letters.width() ) > 0 )
-				{
-					newpos = pos - letters.width() - 1;
-					if ( isValidLocation( letters, newpos, path, newchar ) )
-						search( letters, newpos, path, word, f, hint );
-				}
-
-				newpos = pos - letters.width();
-				if ( isValidLocation( letters, newpos, path, newchar ) )
-					search( letters, newpos, path, word, f, hint );
-
-				if ( ( pos % letters.width() ) < ( letters.width() - 1 ) )
-				{
-					newpos = pos - letters.width() + 1;
-					if ( isValidLocation( letters, newpos, path, newchar ) )
-						search( letters, newpos, path, word, f, hint );
-				}
+				auto const & s = states[ chain[ hints - 1 - i ] ];
+				std::size_t length = std::get< 0 >( *( _firstHint + i ) );
+
+				auto & w = words[ i ];
+				std::copy( spelt.begin() + s.letters, spelt.begin() + s.letters + length, w.cells );
+				std::copy( spelt.begin() + s.letters + length, spelt.begin() + s.letters + 2 * length, w.word );
+				w.word[ length ] = 0;
+				w.letters = &grids[ i ];
+				w.path = s.removed;
+				w.previous = i > 0 ? &words[ i - 1 ] : nullptr;
 			}
 
-			if ( ( pos % letters.width() ) > 0 )
+			addSolution( &words.back() );
+			continue;
+		}
+
+		grid< Bits, Letters > const & now = grids.back();
+
+		if ( !p.fitted )
+		{
+			std::uint64_t rest;
+
+			if ( !fitted( now, p.placed, rest ) )
+				continue;
+
+			p.bound = p.cost + rest;
+			p.fitted = true;
+
+			if ( !queue.empty() && worse( p, queue.top() ) )
 			{
-				newpos = pos - 1;
-				if ( isValidLocation( letters, newpos, path, newchar ) )
-					search( letters, newpos, path, word, f, hint );
+				queue.push( p );
+				continue;
 			}
+		}
+
+		auto hint = _firstHint + p.placed;
+		auto const & costs = _words.costs( p.placed );
+
+		auto placed = [ this, &p, &now, &costs, &least, &hint, &queue, &states, &spelt ]( cursor< Bits > & c, std::uint32_t index )
+		{
+			++c.placed;
+
+			grid< Bits, Letters > next = now.remove( c.path );
+
+			// carrying on from a grid that can't be finished only wastes room in the queue
+			if ( !next.empty() && ( ( _options.feasibility && !feasible( next, hint + 1 ) ) || ( _options.constrainedFirst && !hintsCanBeMet( next, hint + 1 ) ) ) )
+				return;
 
-			if ( ( pos % letters.width() ) < ( letters.width() - 1 ) )
+			if ( states.size() >= _options.maxStates )
 			{
-				newpos = pos + 1;
-				if ( isValidLocation( letters, newpos, path, newchar ) )
-					search( letters, newpos, path, word, f, hint );
+				_outOfStates = true;
+				stop( false );
+				return;
 			}
 
-			if ( ( pos / letters.width() ) < ( letters.height() - 1 ) )
+			states.push_back( state{ c.path, p.last, spelt.size() } );
+			spelt.insert( spelt.end(), c.cells, c.cells + c.length );
+			spelt.insert( spelt.end(), c.word, c.word + c.length );
+
+			auto cost = p.cost + costs[ index ];
+
+			queue.push( partial{ cost + least[ p.placed + 1 ], cost, p.placed + 1, states.size() - 1, false } );
+		};
+
+		auto follows = pairings( now );
+		auto root = _words.trie( p.placed ).root();
+
+		for ( path starts( this->starts( now, hint ) ) ; starts.any() ; )
+		{
+			std::size_t pos = starts.lowest();
+			starts.reset( pos );
+
+			spell( now, pos, c, root, follows, hint, placed );
+		}
+	}
+
+	auto & local = _threadCounts.local();
+	local.nodes += c.nodes;
+	local.placed += c.placed;
+}
+
+template< std::size_t Bits, std::size_t Letters >
+template< typename Placed >
+void puzzle< Bits, Letters >::spell( grid< Bits, Letters > const & letters, std::size_t pos, cursor< Bits > & c, wordtrie::node node, std::array< path, Letters > const & follows, wordhints::const_iterator const & hint, Placed const & placed ) const throw()
+{
+	if ( halted( c ) )
+		return;
+
+	std::size_t first = letterIndex( letters[ pos ] );
+	std::size_t last = first;
+
+	if ( grid< Bits, Letters >::isWild( letters[ pos ] ) )
+	{
+		first = 0;
+		last = _words.symbols().size() - 1;
+	}
+
+	auto const & trie = _words.trie( hint - _firstHint );
+
+	for ( std::size_t l = first ; l <= last ; ++l )
+	{
+		char ch = letterAt( l );
+		auto next = trie.next( node, ch );
+
+		if ( next == wordtrie::dead )
+			continue;
+
+		c.path.set( pos );
+		c.cells[ c.length ] = static_cast< std::uint8_t >( pos );
+		c.word[ c.length++ ] = ch;
+		++c.nodes;
+
+		if ( c.length == std::get< 0 >( *hint ) )
+		{
+			if ( trie.isWord( next ) )
+				placed( c, trie.index( next ) );
+		}
+		else
+		{
+			for ( auto more = letters.neighbours( pos ) & follows[ l ] & ~c.path ; more.any() ; )
 			{
-				if ( ( pos % letters.width() ) > 0 )
-				{
-					newpos = pos + letters.width() - 1;
-					if ( isValidLocation( letters, newpos, path, newchar ) )
-						search( letters, newpos, path, word, f, hint );
-				}
-
-				newpos = pos + letters.width();
-				if ( isValidLocation( letters, newpos, path, newchar ) )
-					search( letters, newpos, path, word, f, hint );
-
-				if ( ( pos % letters.width() ) < ( letters.width() - 1 ) )
-				{
-					newpos = pos + letters.width() + 1;
-					if ( isValidLocation( letters, newpos, path, newchar ) )
-						search( letters, newpos, path, word, f, hint );
-				}
+				std::size_t newpos = more.lowest();
+				more.reset( newpos );
+
+				spell( letters, newpos, c, next, follows, hint, placed );
 			}
 		}
+
+		c.path.reset( pos );
+		--c.length;
 	}
 }
 
-bool puzzle::isMatch( wordhint const & hint, std::string const & word, bool & backwards ) const throw()
+template< std::size_t Bits, std::size_t Letters >
+bool puzzle< Bits, Letters >::isMatch( wordhint const & hint, cursor< Bits > const & c, bool word, bool & backwards ) const throw()
 {
 	auto const & wsatd = std::get< 0 >( hint );
 	auto const & watd = std::get< 1 >( hint );
 	auto const & rwatd = std::get< 2 >( hint );
 
-	if ( watd.size() == word.size() )
-		return watd == word;
+	if ( givenWord( hint ) )
+		return std::memcmp( watd.c_str(), c.word, c.length ) == 0;
 
-	if ( wsatd == rwatd.size() && rwatd == word )
+	if ( wsatd == rwatd.size() && std::memcmp( rwatd.c_str(), c.word, c.length ) == 0 )
 	{
 		backwards = true;
 		return true;
 	}
 
-	return _words.isWord( word );
+	return word;
 }
+
+template class puzzle< 64, ENGLISH_LETTERS >;
+template class puzzle< 128, ENGLISH_LETTERS >;
+template class puzzle< 256, ENGLISH_LETTERS >;
+template class puzzle< 64, MAX_LETTERS >;
+template class puzzle< 128, MAX_LETTERS >;
+template class puzzle< 256, MAX_LETTERS >;
@@ -12,6 +12,11 @@
 #include <tuple>
 #include <bitset>
 #include <deque>
+#include <chrono>
+#include <array>
+#include <vector>
+#include <thread>
+#include <type_traits>
 #include <tbb/tbb.h>
 
 #include "wordcache.hpp"
@@ -19,31 +24,302 @@
 #include "wordpath.hpp"
 #include "grid.hpp"
 
-typedef std::tuple< std::string, grid, wordpath > found;
+// how the words for a hint are looked for in a grid. spreading out from
+// every cell through the prefix tree shares the work between words that
+// start the same way, checking each word in turn is quicker when there
+// are only a few of them
+enum class strategy
+{
+    automatic,      // whichever looks cheaper for each grid
+    cells,          // spread out from each cell
+    words           // trace each word through the grid
+};
+
+// how solutions are written out, text is a line of words per solution,
+// jsonl a json object per line holding the words and the cells of each
+enum class outputformat
+{
+    text,
+    jsonl
+};
+
+struct searchoptions
+{
+    searchoptions() :
+        verbose( false ),
+        feasibility( true ),
+        constrainedFirst( false ),
+        stats( false ),
+        maxSolutions( 0 ),
+        timeout( 0 ),
+        method( strategy::automatic ),
+        format( outputformat::text ),
+        bestFirst( false ),
+        maxStates( 1 << 18 )
+    {
+    }
+
+    bool    verbose;            // display the grid for each word of a solution
+    bool    feasibility;        // prune grids whose letters can't make up the words left
+    bool    constrainedFirst;   // check the hints left, most constrained first, can still be met
+    bool    stats;              // count where the search goes and why it turns back
+    std::size_t maxSolutions;   // stop once this many solutions are found, 0 for all of them
+    double  timeout;            // stop after this many seconds, 0 to run to the end
+    strategy    method;
+    outputformat    format;
+    bool    bestFirst;          // the likeliest solutions first rather than all of them as they come
+    std::size_t maxStates;      // the most partial solutions best first keeps before it gives up
+};
+
+// what one thread saw while searching, merged once the search is done.
+// only collected with searchoptions::stats, otherwise the search is
+// compiled without any of the counting
+struct searchstats
+{
+    searchstats();
+
+    searchstats & operator+=( searchstats const & o ) throw();
+
+    std::array< std::size_t, MAX_BITS > nodes;  // cells stepped onto, by hint
+    std::size_t     pairingRejects;     // neighbours skipped as their letter can't follow
+    std::size_t     prefixRejects;      // letters so far that no word starts with
+    std::size_t     hintRejects;        // letters so far that don't match a partial word hint
+    std::size_t     notWords;           // the right length but not a word
+    std::size_t     matched;            // words that matched their hint, each taken out of the grid
+    std::size_t     deadEndHits;        // grids skipped as searched already
+    std::size_t     wordGrids;          // grids searched word by word rather than cell by cell
+    std::size_t     wordsTraced;        // words whose paths were looked for
+    std::size_t     frontierRejects;    // words that couldn't reach their last letter, even reusing cells
+};
+
+// how much searching one thread did and how many grids it pruned, always
+// counted. each thread counts into its own and they're summed once the
+// search is done, every thread adding to the same counters would pass
+// their cache line from core to core on every grid
+struct searchcounts
+{
+    searchcounts();
+
+    std::size_t     nodes;
+    std::size_t     placed;
+    std::size_t     prunedByLetters;
+    std::size_t     prunedByColumns;
+    std::size_t     prunedByHints;
+};
+
+// a word placed on the way to a solution. records live on the stack of the
+// search that placed them and link back to the word placed before, so
+// placing a word never copies the words placed so far
+template< std::size_t Bits, std::size_t Letters >
+struct found
+{
+    char                    word[ Bits + 1 ];
+    grid< Bits, Letters > const *    letters;    // the grid the word was found in
+    wordpath< Bits >        path;
+    std::uint8_t            cells[ Bits ];  // the path in the order the word is spelt
+    found const *           previous;
+};
+
+// the word being spelt by a search from one start cell, updated in place
+// as the search moves from cell to cell and backs out again. a search
+// split off into its own task gets its own copy
+template< std::size_t Bits >
+struct cursor
+{
+    char                    word[ Bits + 1 ];
+    std::size_t             length;
+    wordpath< Bits >        path;
+    std::uint8_t            cells[ Bits ];
+    std::atomic< bool > *   solved;     // set when a solution is reached from the grid being searched
+    std::size_t             nodes;      // cells stepped onto
+    std::size_t             placed;     // words matched and taken out of the grid
+    searchstats *           stats;      // this thread's counters, with searchoptions::stats
+    tbb::task_group *       group;      // where to put split off searches, if anywhere
+    std::size_t             splitDepth; // split off searches from cells up to this deep
+    std::size_t             start;      // the cell the search started from
+};
+
+// a remaining grid with the hint still to be placed in it. different paths
+// to the same word, and different words, often leave the same letters in
+// the same places so the subtree below is identical
+template< std::size_t Bits >
+struct gridstate
+{
+    std::array< char, Bits >    letters;
+    wordhint const *            hint;
+};
+
+template< std::size_t Bits >
+struct gridstatehash
+{
+    std::size_t operator()( gridstate< Bits > const & s ) const throw();
+    bool operator()( gridstate< Bits > const & a, gridstate< Bits > const & b ) const throw();
+};
 
+// the search, instantiated in puzzle.cpp for each wordpath size and for
+// english or any alphabet. use the smallest that holds the grid
+template< std::size_t Bits, std::size_t Letters >
 class puzzle
 {
 public:
-    puzzle( wordcache const & words, bool verbose );
+    puzzle( wordcache const & words, searchoptions const & options, std::ostream & out );
 
-    void search( grid const & letters, wordhints const & hints ) const throw();
+    void search( grid< Bits, Letters > const & letters, wordhints const & hints ) const throw();
+
+    // sorted, once the search is done
+    inline std::vector< std::string > const & solutions() const throw() { return _solutions; }
+
+    // how many grids the feasibility checks threw away before searching them
+    inline std::size_t prunedByLetters() const throw() { return _prunedByLetters; }
+    inline std::size_t prunedByColumns() const throw() { return _prunedByColumns; }
+    inline std::size_t prunedByHints() const throw() { return _prunedByHints; }
+
+    // how much searching it took, summed over every thread
+    inline std::size_t nodesExpanded() const throw() { return _nodes; }
+    inline std::size_t wordsPlaced() const throw() { return _placed; }
+
+    // the search stopped early, on reaching searchoptions::maxSolutions, the
+    // timeout or, searching best first, searchoptions::maxStates
+    inline bool stopped() const throw() { return _stopped; }
+    inline bool timedOut() const throw() { return _timedOut; }
+    inline bool outOfStates() const throw() { return _outOfStates; }
+
+    // the counters collected with searchoptions::stats, as json
+    void writeStats( std::ostream & out ) const throw();
 
 private:
+    typedef wordpath< Bits >    path;
+
+    template< bool Stats >
+    bool search( grid< Bits, Letters > const & letters, found< Bits, Letters > const * f, wordhints::const_iterator const & hint ) const throw();
+
+    // the likeliest partial solution is always the next one carried on,
+    // so solutions come out most likely first
+    void searchBest( grid< Bits, Letters > const & letters ) const throw();
+
+    // spell out every word for the hint from a cell, handing each one to placed
+    template< typename Placed >
+    void spell( grid< Bits, Letters > const & letters, std::size_t pos, cursor< Bits > & c, wordtrie::node node, std::array< path, Letters > const & follows, wordhints::const_iterator const & hint, Placed const & placed ) const throw();
+
+    // for each letter, the cells holding a letter that can follow it
+    std::array< path, Letters > pairings( grid< Bits, Letters > const & letters ) const throw();
+
+    // the cells no more than 0, 1, 2 .. steps from a cell we couldn't read,
+    // where the pairings and first letters only words needing one of them
+    // have can be. further out than wildSteps they're allowed anywhere
+    static std::size_t const wildSteps = 8;
+
+    std::array< path, wildSteps > nearWild( grid< Bits, Letters > const & letters ) const throw();
+
+    // the cells a word for the hint could start on
+    path starts( grid< Bits, Letters > const & letters, wordhints::const_iterator const & hint ) const throw();
+
+    bool feasible( grid< Bits, Letters > const & letters, wordhints::const_iterator const & hint ) const throw();
+
+    bool hintsCanBeMet( grid< Bits, Letters > const & letters, wordhints::const_iterator const & hint ) const throw();
+
+    void addSolution( found< Bits, Letters > const * f ) const throw();
 
-    void search( grid const & letters, std::deque< found > const & f, wordhints::const_iterator const & hint ) const throw();
+    void write( found< Bits, Letters > const * const * words, std::size_t count, char const * text, std::size_t length ) const throw();
 
-    inline bool isValidLocation( grid const & letters, std::size_t pos, wordpath const & path, char current_char ) const throw();
+    template< bool Stats >
+    void spawn( grid< Bits, Letters > const & letters, std::size_t pos, cursor< Bits > const & c, wordtrie::node node, std::array< path, Letters > const & follows, found< Bits, Letters > const * f, wordhints::const_iterator hint ) const throw();
 
-    void addSolution( std::deque< found > const & fl ) const throw();
+    template< bool Stats >
+    void run( grid< Bits, Letters > const & letters, std::size_t pos, cursor< Bits > c, wordtrie::node node, std::array< path, Letters > const & follows, found< Bits, Letters > const * f, wordhints::const_iterator const & hint ) const throw();
 
-    void search( grid const & letters, std::size_t pos, wordpath path, std::string word, std::deque< found > const & f, wordhints::const_iterator const & hint ) const throw();
+    template< bool Stats >
+    void search( grid< Bits, Letters > const & letters, std::size_t pos, cursor< Bits > & c, wordtrie::node node, std::array< path, Letters > const & follows, found< Bits, Letters > const * f, wordhints::const_iterator const & hint ) const throw();
 
-    bool isMatch( wordhint const & hint, std::string const & word, bool & backwards ) const throw();
+    template< bool Stats >
+    void visit( grid< Bits, Letters > const & letters, std::size_t pos, cursor< Bits > & c, wordtrie::node node, std::array< path, Letters > const & follows, found< Bits, Letters > const * f, wordhints::const_iterator const & hint, char newchar ) const throw();
+
+    void stop( bool timedOut ) const throw();
+
+    bool halted( cursor< Bits > const & c ) const throw();
+
+    bool wordDriven( grid< Bits, Letters > const & letters, wordhints::const_iterator const & hint ) const throw();
+
+    template< bool Stats >
+    void searchWords( grid< Bits, Letters > const & letters, found< Bits, Letters > const * f, wordhints::const_iterator const & hint, std::atomic< bool > & solved ) const throw();
+
+    template< bool Stats >
+    void trace( grid< Bits, Letters > const & letters, std::size_t pos, cursor< Bits > & c, char const * word, found< Bits, Letters > const * f, wordhints::const_iterator const & hint ) const throw();
+
+    template< bool Stats >
+    void place( grid< Bits, Letters > const & letters, cursor< Bits > & c, found< Bits, Letters > const * f, wordhints::const_iterator const & hint, bool backwards ) const throw();
+
+    bool isMatch( wordhint const & hint, cursor< Bits > const & c, bool word, bool & backwards ) const throw();
 
     wordcache const &                   _words;
-    bool                                _verbose;
-    mutable std::mutex                  _solutionLock;
-    mutable std::set< std::string >     _solutions;
+    searchoptions                       _options;
+    std::ostream &                      _out;
+    mutable wordhints::const_iterator   _firstHint;
+    mutable wordhints::const_iterator   _lastHint;
+
+    // solutions are told apart by a hash of their words, spread over
+    // shards by the hash so threads finding solutions at the same time
+    // rarely want the same lock. they're gathered up once the search is done
+    struct shard
+    {
+        std::mutex                          lock;
+        std::unordered_set< std::uint64_t > seen;
+        std::vector< std::string >          solutions;
+    };
+
+    static std::size_t const            shards = 16;
+    mutable std::array< shard, shards > _shards;
+    mutable std::vector< std::string >  _solutions;
     mutable std::atomic< std::size_t >  _count;
+    mutable std::size_t                 _wildcards;     // cells of the starting grid we couldn't read
+
+    // solutions go to a thread of their own to be written out, so a slow
+    // stream never holds up the search. the queue is bounded so a search
+    // finding solutions faster than they can be written waits for it
+    mutable tbb::concurrent_bounded_queue< std::string >    _lines;
+    mutable std::thread                 _writer;
+    mutable tbb::enumerable_thread_specific< searchcounts > _threadCounts;
+    mutable std::size_t                 _prunedByLetters;
+    mutable std::size_t                 _prunedByColumns;
+    mutable std::size_t                 _prunedByHints;
+    mutable std::size_t                 _nodes;
+    mutable std::size_t                 _placed;
+    mutable tbb::enumerable_thread_specific< searchstats >  _threadStats;
+    mutable searchstats                 _stats;
+    mutable std::vector< std::atomic< std::uint64_t > > _startTime;    // nanoseconds spent searching from each first cell
+
+    // stopping early. the flag is checked at every cell, cancelling the
+    // context also stops tbb starting any more of the parallel searches
+    mutable std::atomic< bool >         _stopped;
+    mutable std::atomic< bool >         _timedOut;
+    mutable std::atomic< bool >         _outOfStates;
+    mutable tbb::task_group_context *   _context;
+    mutable std::chrono::steady_clock::time_point   _deadline;
+
+    // remaining grids that we've searched fully and that lead nowhere
+    mutable tbb::concurrent_unordered_set< gridstate< Bits >, gridstatehash< Bits >, gridstatehash< Bits > >   _deadEnds;
 };
 
+// withBits for an alphabet size already picked
+template< typename F, typename Letters >
+auto withCells( std::size_t cells, Letters letters, F const & f )
+{
+    if ( cells <= 64 )
+        return f( std::integral_constant< std::size_t, 64 >(), letters );
+    else if ( cells <= 128 )
+        return f( std::integral_constant< std::size_t, 128 >(), letters );
+    return f( std::integral_constant< std::size_t, 256 >(), letters );
+}
+
+// calls f with the sizes of the smallest puzzle instantiation that holds a
+// grid of this many cells in an alphabet of this many letters, each as a
+// std::integral_constant, i.e.
+//
+//   withBits( cells, words.symbols().size(), [ & ]( auto bits, auto letters ) { puzzle< bits, letters > p( ... ); } );
+template< typename F >
+auto withBits( std::size_t cells, std::size_t letters, F const & f )
+{
+    if ( letters <= ENGLISH_LETTERS )
+        return withCells( cells, std::integral_constant< std::size_t, ENGLISH_LETTERS >(), f );
+    return withCells( cells, std::integral_constant< std::size_t, MAX_LETTERS >(), f );
+}
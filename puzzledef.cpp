@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <cstdlib>
+
+#include "wordpath.hpp"
+#include "grid.hpp"
+#include "puzzledef.hpp"
+
+namespace
+{
+	// letters and, for the letters we don't know, '.' or ' '. it has to give
+	// at least one letter, a hint giving none is just the length
+	bool wellFormedHint( std::string const & word ) throw()
+	{
+		if ( std::any_of( word.begin(), word.end(), []( char c ) { return !isLetter( c ) && c != '.' && c != ' '; } ) )
+			return false;
+
+		return word.find_first_not_of( ". " ) != std::string::npos;
+	}
+}
+
+bool parsePuzzle( std::vector< std::string > const & args, alphabet const & letters, puzzledef & def, std::string & error ) throw()
+{
+	std::stringstream ss;
+
+	if ( args.size() < 4 )
+	{
+		error = "not enough arguments";
+		return false;
+	}
+
+	def.height = std::atoi( args[ 0 ].c_str() );
+	def.width = std::atoi( args[ 1 ].c_str() );
+
+	if ( !letters.encode( args[ 2 ], def.letters ) )
+	{
+		ss << "letters \"" << args[ 2 ] << "\" aren't all in the word list's alphabet";
+		error = ss.str();
+		return false;
+	}
+
+	if ( ( def.height * def.width ) > MAX_BITS )
+	{
+		ss << "grid is too large (" << ( def.height * def.width ) << " cells), at most " << MAX_BITS << " cells are supported";
+		error = ss.str();
+		return false;
+	}
+
+	if ( def.letters.size() != ( def.height * def.width ) )
+	{
+		ss << "letter count (" << def.letters.size() << ") doesn't match grid size (" << def.height << "x" << def.width << ")";
+		error = ss.str();
+		return false;
+	}
+
+	if ( std::size_t( std::count( def.letters.begin(), def.letters.end(), '?' ) ) > grid< MAX_BITS, MAX_LETTERS >::maxWildcards )
+	{
+		ss << "too many unknown letters, at most " << grid< MAX_BITS, MAX_LETTERS >::maxWildcards << " cells can be a '?'";
+		error = ss.str();
+		return false;
+	}
+
+	def.hints.clear();
+
+	for ( std::size_t s = 3 ; s < args.size() ; ++s )
+	{
+		std::size_t val( std::atoi( args[ s ].c_str() ) );
+		if ( val == 0 )
+		{
+			if ( args[ s ].empty() )
+			{
+				error = "empty hint";
+				return false;
+			}
+
+			std::string w;
+
+			if ( !letters.encode( args[ s ], w ) || !wellFormedHint( w ) )
+			{
+				ss << "hint \"" << args[ s ] << "\" is badly formed";
+				error = ss.str();
+				return false;
+			}
+
+			val = w.size();
+
+			// "sh    " and "sh...." are the same hint, as are "..o..l" and "  o  l"
+			std::replace( w.begin(), w.end(), ' ', '.' );
+			w.erase( w.find_last_not_of( "." ) + 1 );
+
+			if ( val != w.size() || w.find( '.' ) != std::string::npos )
+				def.hints.emplace_back( val, w, "" );
+			else
+			{
+				std::string reversed( w );
+				std::reverse( reversed.begin(), reversed.end() );
+				def.hints.emplace_back( val, w, reversed );
+			}
+		}
+		else
+			def.hints.emplace_back( val, "", "" );
+	}
+
+	std::size_t numletters = std::count_if( def.letters.begin(), def.letters.end(), []( char & c ) { return c != ' '; } );
+	std::size_t numspaces = def.letters.size() - numletters;
+
+	std::size_t sumsizes = std::accumulate( def.hints.begin(), def.hints.end(), std::size_t( 0 ),
+		[]( std::size_t a, wordhint const & b )
+		{
+			return a + std::get< 0 >( b );
+		}
+	);
+
+	if ( sumsizes != numletters )
+	{
+		ss << "sum of word sizes (" << sumsizes << ") does not match number of letters (" << numletters << ")";
+		if ( numspaces > 0 )
+			ss << std::endl << "You've supplied a partial grid, you maybe need to reduce your hints";
+		error = ss.str();
+		return false;
+	}
+
+	return true;
+}
+
+std::vector< std::string > splitPuzzleLine( std::string const & line ) throw()
+{
+	std::vector< std::string > args;
+	std::string arg;
+	char quote = 0;
+	bool inArg = false;
+
+	for ( auto const & c : line )
+	{
+		if ( quote != 0 )
+		{
+			if ( c == quote )
+				quote = 0;
+			else
+				arg += c;
+		}
+		else if ( c == '"' || c == '\'' )
+		{
+			quote = c;
+			inArg = true;
+		}
+		else if ( ::isspace( static_cast< unsigned char >( c ) ) )
+		{
+			if ( inArg )
+				args.emplace_back( std::move( arg ) );
+			arg.clear();
+			inArg = false;
+		}
+		else
+		{
+			arg += c;
+			inArg = true;
+		}
+	}
+
+	if ( inArg )
+		args.emplace_back( std::move( arg ) );
+
+	return args;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "wordhint.hpp"
+#include "alphabet.hpp"
+
+// a puzzle as described on the command line or on a line of a batch file,
+// i.e. height width letters hint [ hint ... ]. the letters of the grid and
+// the hints are held as letters of the word list's alphabet
+struct puzzledef
+{
+	std::size_t	height;
+	std::size_t	width;
+	std::string	letters;
+	wordhints	hints;
+};
+
+// parse and validate the arguments of a puzzle, on failure error describes why
+bool parsePuzzle( std::vector< std::string > const & args, alphabet const & letters, puzzledef & def, std::string & error ) throw();
+
+// split a batch line into arguments, quotes group words together
+// ( so space padded hints survive ) and are removed
+std::vector< std::string > splitPuzzleLine( std::string const & line ) throw();
@@ -0,0 +1,290 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "solutioncache.hpp"
+#include "dictionary.hpp"
+
+namespace
+{
+	char const			magic[ 8 ] = { 'P', 'Z', 'L', 'S', 'O', 'L', 'N', 0 };
+	std::uint32_t const	version = 1;
+
+	std::size_t padded( std::size_t n ) throw()
+	{
+		return ( n + 7 ) & ~std::size_t( 7 );
+	}
+
+	void split( char const * text, std::size_t size, std::vector< std::string > & solutions ) throw()
+	{
+		for ( char const * end = text + size ; text < end ; )
+		{
+			char const * eol = static_cast< char const * >( std::memchr( text, '\n', end - text ) );
+
+			if ( eol == nullptr )
+				eol = end;
+
+			solutions.emplace_back( text, eol );
+			text = eol + 1;
+		}
+	}
+}
+
+solutioncache::solutioncache( std::string const & file ) :
+	_file( file ),
+	_good( false ),
+	_fd( -1 ),
+	_map( nullptr ),
+	_mapSize( 0 )
+{
+	header h;
+	std::memcpy( h._magic, magic, sizeof( magic ) );
+	h._version = version;
+	h._reserved = 0;
+
+#ifndef _WIN32
+	_fd = ::open( file.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644 );
+
+	if ( _fd < 0 )
+		return;
+
+	struct stat st;
+
+	if ( ::fstat( _fd, &st ) != 0 )
+		return;
+
+	std::size_t size = st.st_size;
+
+	if ( size == 0 )
+	{
+		if ( ::write( _fd, &h, sizeof( h ) ) != sizeof( h ) )
+			return;
+
+		size = sizeof( h );
+	}
+
+	void * p = ::mmap( nullptr, size, PROT_READ, MAP_PRIVATE, _fd, 0 );
+
+	if ( p == MAP_FAILED )
+		return;
+
+	_map = p;
+	_mapSize = size;
+
+	char const * image = static_cast< char const * >( _map );
+#else
+	{
+		std::fstream f( file, std::ios::in | std::ios::binary );
+
+		if ( f )
+		{
+			f.seekg( 0, std::ios::end );
+			_buffer.resize( static_cast< std::size_t >( f.tellg() ) );
+			f.seekg( 0, std::ios::beg );
+			f.read( _buffer.data(), _buffer.size() );
+		}
+	}
+
+	if ( _buffer.empty() )
+	{
+		std::fstream f( file, std::ios::out | std::ios::binary | std::ios::trunc );
+
+		if ( !f.write( reinterpret_cast< char const * >( &h ), sizeof( h ) ) )
+			return;
+
+		_buffer.assign( reinterpret_cast< char const * >( &h ), reinterpret_cast< char const * >( &h ) + sizeof( h ) );
+	}
+
+	std::size_t size = _buffer.size();
+	char const * image = _buffer.data();
+#endif
+
+	if ( size < sizeof( header ) || std::memcmp( image, magic, sizeof( magic ) ) != 0 )
+	{
+		std::cerr << "\"" << file << "\" is not a solution cache" << std::endl;
+		return;
+	}
+
+	if ( reinterpret_cast< header const * >( image )->_version != version )
+	{
+		std::cerr << "solution cache \"" << file << "\" is version " << reinterpret_cast< header const * >( image )->_version << ", expected " << version << ", delete it" << std::endl;
+		return;
+	}
+
+	std::size_t end = scan( image, size );
+
+	// a record cut short by a writer that died, anything we append after
+	// it would be lost so it has to go
+	if ( end != size )
+	{
+#ifndef _WIN32
+		if ( ::ftruncate( _fd, end ) != 0 )
+			return;
+#else
+		return;
+#endif
+	}
+
+	_good = true;
+}
+
+solutioncache::~solutioncache()
+{
+#ifndef _WIN32
+	if ( _map != nullptr )
+		::munmap( _map, _mapSize );
+
+	if ( _fd >= 0 )
+		::close( _fd );
+#endif
+}
+
+std::size_t solutioncache::scan( char const * image, std::size_t size ) throw()
+{
+	std::size_t offset = sizeof( header );
+
+	while ( offset + sizeof( record ) <= size )
+	{
+		record const * r = reinterpret_cast< record const * >( image + offset );
+		std::size_t length = padded( sizeof( record ) + r->_puzzleSize + r->_textSize );
+
+		if ( offset + length > size )
+			break;
+
+		// a puzzle solved again replaces what was saved before
+		_index[ r->_key ] = r;
+		offset += length;
+	}
+
+	return offset;
+}
+
+bool solutioncache::good() const throw()
+{
+	return _good;
+}
+
+std::size_t solutioncache::size() const throw()
+{
+	return _index.size();
+}
+
+std::string solutioncache::canonical( puzzledef const & def ) throw()
+{
+	std::ostringstream ss;
+
+	ss << def.height << " " << def.width << " " << def.letters;
+
+	for ( auto const & h : def.hints )
+	{
+		ss << " " << std::get< 0 >( h );
+
+		if ( !std::get< 1 >( h ).empty() )
+			ss << ":" << std::get< 1 >( h );
+	}
+
+	return ss.str();
+}
+
+std::uint64_t solutioncache::key( std::string const & puzzle, std::uint64_t fingerprint ) throw()
+{
+	return dictionary::hash( puzzle.data(), puzzle.size(), dictionary::hash( &fingerprint, sizeof( fingerprint ) ) );
+}
+
+bool solutioncache::find( puzzledef const & def, std::uint64_t fingerprint, std::vector< std::string > & solutions ) const throw()
+{
+	if ( !_good )
+		return false;
+
+	auto puzzle = canonical( def );
+	auto k = key( puzzle, fingerprint );
+
+	solutions.clear();
+
+	{
+		std::lock_guard< std::mutex > g( _lock );
+
+		auto i = _added.find( k );
+
+		if ( i != _added.end() )
+		{
+			if ( i->second.fingerprint != fingerprint || i->second.puzzle != puzzle )
+				return false;
+
+			split( i->second.text.data(), i->second.text.size(), solutions );
+			return true;
+		}
+	}
+
+	auto i = _index.find( k );
+
+	if ( i == _index.end() )
+		return false;
+
+	record const * r = i->second;
+	char const * text = reinterpret_cast< char const * >( r + 1 );
+
+	// the key is only a hash, make sure it really is the same puzzle
+	if ( r->_fingerprint != fingerprint || puzzle.size() != r->_puzzleSize || std::memcmp( puzzle.data(), text, puzzle.size() ) != 0 )
+		return false;
+
+	split( text + r->_puzzleSize, r->_textSize, solutions );
+
+	return true;
+}
+
+bool solutioncache::add( puzzledef const & def, std::uint64_t fingerprint, std::vector< std::string > const & solutions ) throw()
+{
+	if ( !_good )
+		return false;
+
+	entry e;
+	e.fingerprint = fingerprint;
+	e.puzzle = canonical( def );
+
+	for ( auto const & s : solutions )
+	{
+		e.text += s;
+		e.text += '\n';
+	}
+
+	record r;
+	r._key = key( e.puzzle, fingerprint );
+	r._fingerprint = fingerprint;
+	r._puzzleSize = static_cast< std::uint32_t >( e.puzzle.size() );
+	r._textSize = static_cast< std::uint32_t >( e.text.size() );
+	r._count = static_cast< std::uint32_t >( solutions.size() );
+	r._reserved = 0;
+
+	// the whole record goes out in one write so other processes appending
+	// to the same file can't interleave with it
+	std::vector< char > out( padded( sizeof( r ) + e.puzzle.size() + e.text.size() ), 0 );
+
+	std::memcpy( out.data(), &r, sizeof( r ) );
+	std::memcpy( out.data() + sizeof( r ), e.puzzle.data(), e.puzzle.size() );
+	std::memcpy( out.data() + sizeof( r ) + e.puzzle.size(), e.text.data(), e.text.size() );
+
+	std::lock_guard< std::mutex > g( _lock );
+
+#ifndef _WIN32
+	if ( ::write( _fd, out.data(), out.size() ) != static_cast< ssize_t >( out.size() ) )
+		return false;
+#else
+	std::fstream f( _file, std::ios::out | std::ios::binary | std::ios::app );
+
+	if ( !f.write( out.data(), out.size() ) )
+		return false;
+#endif
+
+	_added[ r._key ] = std::move( e );
+
+	return true;
+}
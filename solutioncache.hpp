@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <unordered_map>
+
+#include "puzzledef.hpp"
+
+// every solution of the puzzles solved so far, saved to a file so solving
+// the same puzzle again is a lookup rather than a search.
+//
+// a puzzle is keyed by a hash of its size, letters and hints and the
+// fingerprint of the word list it was solved against. the file is only
+// ever appended to, each record holding the whole solution set of one
+// puzzle, and is mapped read only to look puzzles up. records added while
+// it's open are kept in memory as well so later puzzles in a batch see them.
+//
+// the solution sets are solved without any excluded words. excluding a
+// word can only take solutions away, so the same record answers whatever
+// the exclude list holds once those words are filtered out of it.
+class solutioncache
+{
+public:
+	explicit solutioncache( std::string const & file );
+	~solutioncache();
+
+	solutioncache( solutioncache const & ) = delete;
+	solutioncache & operator=( solutioncache const & ) = delete;
+
+	bool good() const throw();
+
+	// the solutions saved for a puzzle, false if it hasn't been solved against this word list
+	bool find( puzzledef const & def, std::uint64_t fingerprint, std::vector< std::string > & solutions ) const throw();
+
+	// save every solution of a puzzle, a search that stopped early mustn't be saved
+	bool add( puzzledef const & def, std::uint64_t fingerprint, std::vector< std::string > const & solutions ) throw();
+
+	// how many puzzles the file held when it was opened
+	std::size_t size() const throw();
+
+	// the puzzle written out in one form whatever spacing or case it was given in
+	static std::string canonical( puzzledef const & def ) throw();
+
+private:
+
+	struct header
+	{
+		char			_magic[ 8 ];
+		std::uint32_t	_version;
+		std::uint32_t	_reserved;
+	};
+
+	// followed by the canonical puzzle and then the solutions one per line,
+	// padded so the next record is 8 byte aligned
+	struct record
+	{
+		std::uint64_t	_key;
+		std::uint64_t	_fingerprint;
+		std::uint32_t	_puzzleSize;
+		std::uint32_t	_textSize;
+		std::uint32_t	_count;
+		std::uint32_t	_reserved;
+	};
+
+	struct entry
+	{
+		std::uint64_t		fingerprint;
+		std::string			puzzle;
+		std::string			text;
+	};
+
+	static std::uint64_t key( std::string const & puzzle, std::uint64_t fingerprint ) throw();
+
+	std::size_t scan( char const * image, std::size_t size ) throw();
+
+	std::string				_file;
+	bool					_good;
+	int						_fd;
+	void *					_map;
+	std::size_t				_mapSize;
+	std::vector< char >		_buffer;
+
+	std::unordered_map< std::uint64_t, record const * >	_index;
+
+	mutable std::mutex								_lock;
+	std::unordered_map< std::uint64_t, entry >		_added;
+};
@@ -2,174 +2,348 @@
 #include <numeric>
 #include <fstream>
 #include <algorithm>
-#include <deque>
 #include <cstring>
+#include <map>
+#include <cmath>
 
 #include "wordcache.hpp"
 
-
-wordcache::wordcache( std::string const & file, std::vector< wordhint > const & hints, std::string const & letters, std::string const & excludefile )
+namespace
 {
-	std::vector< std::string > excluded;
-
+	// how many steps a letter of a word can be from a cell we couldn't read.
+	// for each letter the grid hasn't enough of, one of its places in the
+	// word has to be on such a cell, any of them, so it's the furthest of
+	// those places from the letter, for whichever letter that's nearest
+	std::uint8_t wildReach( char const * word, std::size_t length, std::size_t at, lettercounts const & counts, lettercounts const & available ) throw()
 	{
-		std::fstream f( excludefile );
-		std::string word;
-		while( f >> word )
+		std::array< std::size_t, MAX_LETTERS > furthest;
+		furthest.fill( 0 );
+
+		for ( std::size_t k = 0 ; k < length ; ++k )
 		{
-			std::transform( word.begin(), word.end(), word.begin(), ::tolower );
+			auto c = letterIndex( word[ k ] );
+			furthest[ c ] = std::max( furthest[ c ], at > k ? at - k : k - at );
+		}
+
+		std::size_t steps = wordcache::anywhere;
 
-			excluded.emplace_back( std::move( word ) );
+		for ( std::size_t c = 0 ; c < MAX_LETTERS ; ++c )
+		{
+			if ( counts[ c ] > available[ c ] )
+				steps = std::min( steps, furthest[ c ] );
 		}
 
-		std::sort( excluded.begin(), excluded.end() );
+		return static_cast< std::uint8_t >( steps );
 	}
+}
+
+wordcache::wordcache( dictionary const & dict, std::vector< wordhint > const & hints, std::string const & letters, std::ostream & out, std::string const & excludefile ) :
+	wordcache( dict, hints, letters, out, excludedWords( excludefile, dict.symbols() ) )
+{
+}
 
+wordcache::wordcache( dictionary const & dict, std::vector< wordhint > const & hints, std::string const & letters, std::ostream & out, std::vector< std::string > const & excluded ) :
+	_symbols( dict.symbols() )
+{
 	std::string uniqueLetters( letters );
 
-    std::sort( uniqueLetters.begin(), uniqueLetters.end() );
+	uniqueLetters.erase( std::remove_if( uniqueLetters.begin(), uniqueLetters.end(), []( char c ) { return !isLetter( c ); } ), uniqueLetters.end() );
+    std::sort( uniqueLetters.begin(), uniqueLetters.end(), []( char a, char b ) { return letterIndex( a ) < letterIndex( b ); } );
     uniqueLetters.erase( std::unique( uniqueLetters.begin(), uniqueLetters.end() ), uniqueLetters.end() );
 
-	std::cout << uniqueLetters.size() << " unique letters : ";
+	out << uniqueLetters.size() << " unique letters : ";
 	for ( auto const & c : uniqueLetters )
-		std::cout << c << " ";
-	std::cout << std::endl;
-
-	{
-		std::fstream f( file );
-		std::string word;
-		while( f >> word )
-		{
-			if ( std::binary_search( excluded.begin(), excluded.end(), word ) )
-				continue;
+		out << _symbols.decode( &c, 1 ) << " ";
+	out << std::endl;
 
-			if ( std::find_if( hints.begin(), hints.end(), [ &word ]( wordhint const & h ) { return std::get< 0 >( h ) == word.size(); } ) == hints.end() )
-				continue;
+	// cells we couldn't read can be any letter, so words can use that many
+	// letters the grid doesn't show and any letter can start or follow one
+	std::size_t wild = std::count( letters.begin(), letters.end(), '?' );
+	std::string usableLetters( uniqueLetters );
 
-			if ( word.find_first_not_of( uniqueLetters ) != std::string::npos )
-				continue;
+	if ( wild != 0 )
+	{
+		usableLetters.clear();
+		for ( std::size_t c = 0 ; c < _symbols.size() ; ++c )
+			usableLetters += letterAt( c );
+	}
 
-			std::transform( word.begin(), word.end(), word.begin(), ::tolower );
+	if ( wild != 0 )
+		out << wild << " unknown letters" << std::endl;
 
-			_words.emplace_back( std::move( word ) );
-		}
+	// how many of each letter the grid has, a word needing more of
+	// a letter than that can never be made from it
+	lettercounts available;
+	available.fill( 0 );
 
-		std::sort( _words.begin(), _words.end() );
+	for ( auto const & c : letters )
+	{
+		if ( isLetter( c ) )
+			++available[ letterIndex( c ) ];
 	}
 
-	std::deque< std::string > char_pairings;
+	{
+		// only look at the word lengths we've got hints for and the first
+		// letters that are in the grid, and then only keep words whose
+		// letters are all in the grid. the words themselves stay in the
+		// dictionary image, we only keep pointers to them
+		std::vector< std::size_t > lengths;
 
-    // we now do some analysis of words and the letters in the grid
-    // searching for letter pairings, i.e. if  a combination of
-    // two letters from the unique letters isn't found in the words then
-    // we get rid of that char pairing as an optimisation. The search
-    // algorithm knows which letter it's currently "on" and the next
-    // letter it's proposing to search next. if the two pair combinations
-    // aren't possible then we can reject that search.
-    //
-    // for example.
-    //
-    // say we have a unique set of letters : uhovnalwetirgsc
-    // we produce a large set of possible char pairings, i.e. uh, wn, og
-    // we then search all the words and see if those char pairings exist.
-    // if the char pairing exists, i.e. it's possible that a word could be
-    // chosen with it. then we remember it and allow it to be chosen
-    // by the search
+		for ( auto const & h : hints )
+			lengths.push_back( std::get< 0 >( h ) );
 
+		std::sort( lengths.begin(), lengths.end() );
+		lengths.erase( std::unique( lengths.begin(), lengths.end() ), lengths.end() );
 
-    // Build all possible character combinations based on letter grid
-	{
-		char buf[ 2 ];
-		for ( auto const & i : uniqueLetters )
+		auto available = dictionary::lettersOf( uniqueLetters.c_str() );
+
+		for ( auto const & l : lengths )
 		{
-			for ( auto const & j : uniqueLetters )
+			for ( auto const & c : usableLetters )
 			{
-				buf[ 0 ] = i;
-				buf[ 1 ] = j;
-				char_pairings.emplace_back( buf, 2 );
+				auto r = dict.words( l, c );
+
+				for ( auto i = r.first ; i < r.second ; ++i )
+				{
+					if ( bitCount( dict.letters( i ) & ~available ) > wild )
+						continue;
+
+					char const * word = dict.word( i );
+
+					if ( std::binary_search( excluded.begin(), excluded.end(), word ) )
+						continue;
+
+					_words.push_back( word );
+				}
 			}
 		}
-	}
-
-	std::cout << char_pairings.size() << " possible char pairings" << std::endl;
 
-    _pairingsInUse.fill( 2 );   // fill with 2 to indicate that this char pairing wasn't even considered
+		std::sort( _words.begin(), _words.end(), []( char const * a, char const * b ) { return std::strcmp( a, b ) < 0; } );
+	}
 
-    // now see if these char pairings can be found in the list of words we've recovered.
-    // if not, then they are illegal and will be used to decide whether to 
-    // continue searching
+    // we now do some analysis of the words and the letters in the grid
+    // searching for letter pairings, i.e. if a combination of two letters
+    // from the unique letters isn't found in the words then we get rid of
+    // that char pairing as an optimisation. The search algorithm knows
+    // which letter it's currently "on" and the next letter it's proposing
+    // to search next. if the two pair combinations aren't possible then
+    // we can reject that search.
     //
-    // Note. there are 676 possible 2 character pairings (26^2)
-    // for speed we'll use a std::array< char >( 676 ) as flags
+    // Note. there are MAX_LETTERS^2 possible 2 character pairings, 676 of them
+    // for english, for speed we'll use a std::array< char > of all of them as flags
     // ( we could use bitset but it'd be slightly slower due to the arithmetic involved )
     //
-	for ( auto it = char_pairings.begin() ; it != char_pairings.end() ; ++it )
+    _pairingsInUse.fill( 2 );   // fill with 2 to indicate that this char pairing wasn't even considered
+
+	for ( auto const & i : usableLetters )
+		for ( auto const & j : usableLetters )
+			_pairingsInUse[ ( letterIndex( i ) * MAX_LETTERS ) + letterIndex( j ) ] = 0;   // considered, not found yet
+
+	out << usableLetters.size() * usableLetters.size() << " possible char pairings" << std::endl;
+
+	// full word hints are taken out of the words below but they're
+	// still answers, and they may not even be in the dictionary. with
+	// cells we couldn't read, a pairing only found in words needing one of
+	// them is only followed near them, how near depending on how far along
+	// the word it is from the letter the grid is short of
+	_pairingReach.fill( wild == 0 ? anywhere : 0 );
+
+	auto scan = [ this, wild, &available ]( char const * w, std::size_t length )
 	{
-		bool found = false;
+		lettercounts counts;
+		counts.fill( 0 );
 
-		for ( auto const & w : _words )
+		if ( wild != 0 )
 		{
-			auto f = w.find( *it );
+			for ( std::size_t p = 0 ; p < length ; ++p )
+				++counts[ letterIndex( w[ p ] ) ];
+		}
 
-			if ( f != std::string::npos )
-			{
-				found = true;
-				break;
-			}
+		for ( std::size_t p = 0 ; p + 1 < length ; ++p )
+		{
+			std::size_t pair = ( letterIndex( w[ p ] ) * MAX_LETTERS ) + letterIndex( w[ p + 1 ] );
+
+			_pairingsInUse[ pair ] = 1;
+
+			if ( wild != 0 )
+				_pairingReach[ pair ] = std::max( _pairingReach[ pair ], wildReach( w, length, p + 1, counts, available ) );
 		}
+	};
 
-        std::size_t idx = ( ( (*it)[ 0 ] - 'a' ) * 26 ) + ( (*it)[ 1 ] - 'a' );
-		if ( found )
-        {
-            _pairingsInUse[ idx ] = 1;  // mark this as a legal char pairing
-        }
-        else
-        {
-            _pairingsInUse[ idx ] = 0;  // mark this as considered, but not found
-        }
+	for ( auto const & w : _words )
+		scan( w, std::strlen( w ) );
+
+	for ( auto const & h : hints )
+	{
+		if ( givenWord( h ) )
+			scan( std::get< 1 >( h ).c_str(), std::get< 0 >( h ) );
 	}
 
-    std::cout << std::accumulate( _pairingsInUse.begin(), _pairingsInUse.end(), std::size_t{0}, []( std::size_t c1, char c2 ) { return c1 + ( ( c2 == 1 ) ? 1 : 0 ); } ) << " char pairings found in available words" << std::endl;
+    out << std::accumulate( _pairingsInUse.begin(), _pairingsInUse.end(), std::size_t{0}, []( std::size_t c1, char c2 ) { return c1 + ( ( c2 == 1 ) ? 1 : 0 ); } ) << " char pairings found in available words" << std::endl;
 
-    std::cout << "These pairings were rejected : ";
-    for ( std::size_t p{ 0 } ; p < _pairingsInUse.size() ; ++p )
+    out << "These pairings were rejected : ";
+    for ( std::size_t i{ 0 } ; i < _symbols.size() ; ++i )
     {
-        if ( _pairingsInUse[ p ] != 1 )
+        for ( std::size_t j{ 0 } ; j < _symbols.size() ; ++j )
         {
-            std::cout << (char)( ( p / 26 ) + 'a' ) << (char)( ( p % 26 ) + 'a' ) << " ";
+            if ( _pairingsInUse[ i * MAX_LETTERS + j ] != 1 )
+            {
+                char pair[] = { letterAt( i ), letterAt( j ) };
+                out << _symbols.decode( pair, 2 ) << " ";
+            }
         }
     }
-    std::cout << std::endl;
+    out << std::endl;
 
-	// can't remove hints until now as they must participate in char_pairing analysis
+	// full word hints get a prefix tree of their own below
 	for ( auto const & h : hints )
 	{
-		if ( std::get< 0 >( h ) == std::get< 1 >( h ).size() )
-			_words.erase( std::remove( _words.begin(), _words.end(), std::get< 1 >( h ) ), _words.end() );
+		if ( givenWord( h ) )
+		{
+			auto const & word = std::get< 1 >( h );
+			_words.erase( std::remove_if( _words.begin(), _words.end(), [ &word ]( char const * w ) { return word == w; } ), _words.end() );
+		}
+	}
+
+	// work out the candidates for each hint and the letter budgets from
+	// the last hint back to the first. each hint also gets a prefix tree
+	// of only the words that could answer it, words of its length with
+	// the letters it gives where it gives them and that the grid has
+	// enough letters for. the search walks the tree of the hint it's on,
+	// so it never steps towards a word of the wrong length or off a given
+	// letter, wherever in the word that is, and the tree it's walking is
+	// a fraction of the size of one holding every word. hints of the same
+	// length giving the same letters share a tree
+	_budgets.resize( hints.size() + 1 );
+	_budgets.back().fill( 0 );
+	_candidates.resize( hints.size() );
+	_firstLetters.resize( hints.size() );
+	_firstReach.resize( hints.size() );
+	_candidateWords.resize( hints.size() );
+	_costs.resize( hints.size() );
+	_givenWords.resize( hints.size() );
+	_hintTries.resize( hints.size() );
+
+	std::map< std::pair< std::size_t, std::string >, std::size_t > shared;
+
+	for ( std::size_t i = hints.size() ; i-- > 0 ; )
+	{
+		auto const & size = std::get< 0 >( hints[ i ] );
+		auto const & hint = std::get< 1 >( hints[ i ] );
+
+		auto key = std::make_pair( size, hint );
+		auto existing = shared.find( key );
+		bool build = existing == shared.end();
+
+		if ( build )
+		{
+			shared[ key ] = _tries.size();
+			_hintTries[ i ] = _tries.size();
+			_tries.emplace_back( _symbols.size() );
+		}
+		else
+			_hintTries[ i ] = existing->second;
+
+		wordtrie & trie = _tries[ _hintTries[ i ] ];
+
+		lettercounts most;
+		most.fill( 0 );
+
+		auto & candidates = _candidates[ i ];
+		auto & firstLetters = _firstLetters[ i ];
+		firstLetters.fill( 0 );
+
+		auto & firstReach = _firstReach[ i ];
+		firstReach.fill( wild == 0 ? anywhere : 0 );
+
+		auto & candidateWords = _candidateWords[ i ];
+
+		auto take = [ &most, &candidates, &firstLetters, &firstReach, &candidateWords, &trie, &available, wild, build, size ]( char const * word, bool check )
+		{
+			lettercounts counts;
+			counts.fill( 0 );
+
+			for ( char const * w = word ; *w ; ++w )
+				++counts[ letterIndex( *w ) ];
+
+			if ( check && shortfall( counts, available ) > wild )
+				return;
+
+			++firstLetters[ letterIndex( *word ) ];
+
+			if ( wild != 0 )
+				firstReach[ letterIndex( *word ) ] = std::max( firstReach[ letterIndex( *word ) ], wildReach( word, size, 0, counts, available ) );
+
+			for ( std::size_t c = 0 ; c < most.size() ; ++c )
+				most[ c ] = std::max( most[ c ], counts[ c ] );
+
+			candidates.push_back( counts );
+			candidateWords.push_back( word );
+
+			if ( build )
+				trie.insert( word, static_cast< std::uint32_t >( candidateWords.size() - 1 ) );
+		};
+
+		if ( givenWord( hints[ i ] ) )
+		{
+			_givenWords[ i ] = hint;
+			take( _givenWords[ i ].c_str(), false );
+		}
+		else
+		{
+			for ( auto const & w : _words )
+			{
+				if ( std::strlen( w ) == size && fitsHint( hint, w, size ) )
+					take( w, true );
+			}
+		}
+
+		// a word's cost is the information in it being the answer, -log2
+		// of its share of how common the hint's words are between them
+		auto & costs = _costs[ i ];
+		double total = 0;
+
+		for ( auto const & w : candidateWords )
+			total += dict.frequency( w ) + 1.0;
+
+		for ( auto const & w : candidateWords )
+			costs.push_back( static_cast< std::uint32_t >( std::log2( total / ( dict.frequency( w ) + 1.0 ) ) * costScale + 0.5 ) );
+
+		for ( std::size_t c = 0 ; c < most.size() ; ++c )
+			_budgets[ i ][ c ] = static_cast< std::uint8_t >( std::min( 255, most[ c ] + _budgets[ i + 1 ][ c ] ) );
 	}
-}
 
-bool wordcache::isValidCharPairing( char c1, char c2 ) const throw()
-{
-	return _pairingsInUse[ ( ( c1 - 'a' ) * 26 ) + ( c2 - 'a' ) ] == 1;
+	std::size_t nodes = 0;
+	for ( auto const & t : _tries )
+		nodes += t.size();
+
+	out << nodes << " prefix tree nodes over " << _tries.size() << " hint word lists" << std::endl;
 }
 
-std::size_t wordcache::size() const throw()
+std::vector< std::string > wordcache::excludedWords( std::string const & file, alphabet const & letters ) throw()
 {
-	return _words.size();
+	std::vector< std::string > excluded;
+
+	std::fstream f( file );
+	std::string word;
+	std::string symbols;
+	while( f >> word )
+	{
+		if ( letters.encode( word, symbols ) )
+			excluded.push_back( symbols );
+	}
+
+	std::sort( excluded.begin(), excluded.end() );
+
+	return excluded;
 }
-	
-bool wordcache::isWord( std::string const & word ) const throw()
+
+bool wordcache::isValidCharPairing( char c1, char c2 ) const throw()
 {
-	return std::binary_search( _words.begin(), _words.end(), word );
+	return _pairingsInUse[ ( letterIndex( c1 ) * MAX_LETTERS ) + letterIndex( c2 ) ] == 1;
 }
 
-bool wordcache::canBeginWith( std::string const & word ) const throw()
+std::size_t wordcache::size() const throw()
 {
-	auto it = std::upper_bound( _words.begin(), _words.end(), word );
-
-	if ( it == _words.end() )
-		return false;
-
-	return std::strncmp( it->c_str(), word.c_str(), word.size() ) == 0;
+	return _words.size();
 }
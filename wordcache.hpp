@@ -2,39 +2,86 @@
 
 #include <string>
 #include <vector>
-#include <unordered_set>
-#include <tuple>
+#include <array>
+#include <ostream>
 
 #include "wordhint.hpp"
+#include "wordtrie.hpp"
+#include "dictionary.hpp"
+#include "grid.hpp"
 
-size_t hash_value( std::tuple< char, char > const & t );
-
+// the words that could answer the hints of one puzzle. the letters of the
+// grid and the hints are letters of the dictionary's alphabet, as are the
+// words, see puzzledef.hpp
 class wordcache
 {
 public:
-	wordcache( std::string const & file, std::vector< wordhint > const & hints, std::string const & letters, std::string const & excludefile = "exclude.txt" );
+	wordcache( dictionary const & dict, std::vector< wordhint > const & hints, std::string const & letters, std::ostream & out, std::string const & excludefile = "exclude.txt" );
+
+	// the same but leaving out a list of excluded words already read, sorted.
+	// a batch reads its exclude list once and derives each puzzle's words
+	// from the one dictionary and list
+	wordcache( dictionary const & dict, std::vector< wordhint > const & hints, std::string const & letters, std::ostream & out, std::vector< std::string > const & excluded );
+
+	// the words in an exclude file as letters, sorted. words with a letter
+	// the alphabet doesn't have can't turn up anyway so they're dropped
+	static std::vector< std::string > excludedWords( std::string const & file, alphabet const & letters ) throw();
+
+	inline alphabet const & symbols() const throw() { return _symbols; }
 
 	bool isValidCharPairing( char c1, char c2 ) const throw();
 
+	// a pairing or first letter only words the grid is short of a letter
+	// for have can only be where one of those words is, so no further
+	// from a cell we couldn't read than this many steps. anywhere when a
+	// word the grid's own letters can make has it
+	static std::uint8_t const anywhere = 0xff;
+
+	inline std::uint8_t pairingReach( char c1, char c2 ) const throw() { return _pairingReach[ ( letterIndex( c1 ) * MAX_LETTERS ) + letterIndex( c2 ) ]; }
+	inline std::array< std::uint8_t, MAX_LETTERS > const & firstReach( std::size_t hint ) const throw() { return _firstReach[ hint ]; }
+
 	std::size_t size() const throw();
-	
-	bool isWord( std::string const & word ) const throw();
 
-	bool canBeginWith( std::string const & word ) const throw();
+	// the prefix tree of the words that could answer a hint
+	inline wordtrie const & trie( std::size_t hint ) const throw() { return _tries[ _hintTries[ hint ] ]; }
+
+	// the most of each letter that the words for this hint and the hints after
+	// it could use between them, a grid holding more of any letter can't be solved
+	inline lettercounts const & letterBudget( std::size_t hint ) const throw() { return _budgets[ hint ]; }
+
+	// the letter counts of every word that could answer a hint, and how
+	// many of those words start with each letter
+	inline std::vector< lettercounts > const & candidates( std::size_t hint ) const throw() { return _candidates[ hint ]; }
+	inline std::array< std::size_t, MAX_LETTERS > const & firstLetters( std::size_t hint ) const throw() { return _firstLetters[ hint ]; }
+
+	// the words themselves, in the same order as their letter counts
+	inline std::vector< char const * > const & candidateWords( std::size_t hint ) const throw() { return _candidateWords[ hint ]; }
+
+	// how unlikely each of those words is to be the answer, in 1 / costScale
+	// bits, from how common the word list says they are. the prefix tree
+	// gives the index of a word in these lists
+	static std::uint32_t const costScale = 1024;
+
+	inline std::vector< std::uint32_t > const & costs( std::size_t hint ) const throw() { return _costs[ hint ]; }
 
 private:
 
-    struct key_hash : public std::unary_function< std::tuple< char, char >, std::size_t>
-    {
-        std::size_t operator()( std::tuple< char, char > const & k ) const
-        {
-            return std::get< 0 >( k ) * 26 + std::get< 1 >( k ) ;
-        }
-    };
+	alphabet const &				_symbols;
+	std::vector< char const * >		_words;		// points into the dictionary image
+
+    std::array< char, MAX_LETTERS * MAX_LETTERS > _pairingsInUse;
+	std::array< std::uint8_t, MAX_LETTERS * MAX_LETTERS >	_pairingReach;
+
+	std::vector< wordtrie >		_tries;
+	std::vector< std::size_t >	_hintTries;	// which of the tries each hint uses
 
-	std::vector< std::string >                                  _words;
-	std::unordered_set< std::tuple< char, char >, key_hash >    _illegal_char_pairings;
+	std::vector< lettercounts >	_budgets;	// one per hint, plus an empty one past the last
 
-    std::array< char, 676 > _pairingsInUse;
+	std::vector< std::vector< lettercounts > >		_candidates;
+	std::vector< std::array< std::size_t, MAX_LETTERS > >	_firstLetters;
+	std::vector< std::array< std::uint8_t, MAX_LETTERS > >	_firstReach;
+	std::vector< std::vector< char const * > >		_candidateWords;	// point into the dictionary, or _givenWords for full word hints
+	std::vector< std::vector< std::uint32_t > >		_costs;
+	std::vector< std::string >						_givenWords;
 };
 
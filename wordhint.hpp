@@ -1,6 +1,31 @@
 #pragma once
 #include <tuple>
 #include <string>
+#include <vector>
 
+// the length of the word, the letters of it we know as a pattern with a
+// '.' for each letter we don't ( trailing ones dropped, so a hint giving
+// the start of a word is only those letters ) and, if the hint gives the
+// whole word, the word backwards
 typedef std::tuple< std::size_t, std::string, std::string > wordhint;
 typedef std::vector< wordhint > wordhints;
+
+// the hint gives every letter of the word
+inline bool givenWord( wordhint const & h ) throw()
+{
+	auto const & pattern = std::get< 1 >( h );
+
+	return pattern.size() == std::get< 0 >( h ) && pattern.find( '.' ) == std::string::npos;
+}
+
+// whether the first n letters of a word agree with the letters a hint gives
+inline bool fitsHint( std::string const & pattern, char const * word, std::size_t n ) throw()
+{
+	for ( std::size_t i = 0 ; i < n && i < pattern.size() ; ++i )
+	{
+		if ( pattern[ i ] != '.' && pattern[ i ] != word[ i ] )
+			return false;
+	}
+
+	return true;
+}
@@ -1,6 +1,98 @@
 #pragma once
 
-#include <bitset>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 
-#define MAX_BITS 64
-typedef std::bitset< MAX_BITS > wordpath;
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// the largest grid we can solve, grids are solved with the smallest
+// wordpath that holds them, see the instantiations in grid.cpp and puzzle.cpp
+#define MAX_BITS 256
+
+// index of the lowest set bit, v must not be 0
+inline std::size_t lowestBit( unsigned long long v ) throw()
+{
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward64( &idx, v );
+	return idx;
+#else
+	return __builtin_ctzll( v );
+#endif
+}
+
+inline std::size_t bitCount( unsigned long long v ) throw()
+{
+#ifdef _MSC_VER
+	return __popcnt64( v );
+#else
+	return __builtin_popcountll( v );
+#endif
+}
+
+// a set of grid cells, one bit per cell held in as few 64 bit words as
+// Bits needs. a 64 cell grid is a single register, larger grids are a
+// short fixed array the compiler can unroll and vectorise
+template< std::size_t Bits >
+class wordpath
+{
+public:
+	static std::size_t const words = ( Bits + 63 ) / 64;
+
+	inline wordpath() throw() { _w.fill( 0 ); }
+
+	inline bool test( std::size_t pos ) const throw() { return ( _w[ pos >> 6 ] >> ( pos & 63 ) ) & 1; }
+	inline wordpath & set( std::size_t pos ) throw() { _w[ pos >> 6 ] |= std::uint64_t( 1 ) << ( pos & 63 ); return *this; }
+	inline wordpath & reset( std::size_t pos ) throw() { _w[ pos >> 6 ] &= ~( std::uint64_t( 1 ) << ( pos & 63 ) ); return *this; }
+	inline wordpath & reset() throw() { _w.fill( 0 ); return *this; }
+
+	inline bool any() const throw()
+	{
+		std::uint64_t v = 0;
+		for ( std::size_t i = 0 ; i < words ; ++i )
+			v |= _w[ i ];
+		return v != 0;
+	}
+
+	inline bool none() const throw() { return !any(); }
+
+	inline std::size_t count() const throw()
+	{
+		std::size_t n = 0;
+		for ( std::size_t i = 0 ; i < words ; ++i )
+			n += bitCount( _w[ i ] );
+		return n;
+	}
+
+	// the lowest set cell, the path must not be empty
+	inline std::size_t lowest() const throw()
+	{
+		std::size_t i = 0;
+		while ( _w[ i ] == 0 )
+			++i;
+		return ( i << 6 ) + lowestBit( _w[ i ] );
+	}
+
+	inline wordpath & operator&=( wordpath const & o ) throw() { for ( std::size_t i = 0 ; i < words ; ++i ) _w[ i ] &= o._w[ i ]; return *this; }
+	inline wordpath & operator|=( wordpath const & o ) throw() { for ( std::size_t i = 0 ; i < words ; ++i ) _w[ i ] |= o._w[ i ]; return *this; }
+
+	inline wordpath operator&( wordpath const & o ) const throw() { wordpath r( *this ); return r &= o; }
+	inline wordpath operator|( wordpath const & o ) const throw() { wordpath r( *this ); return r |= o; }
+
+	inline wordpath operator~() const throw()
+	{
+		wordpath r;
+		for ( std::size_t i = 0 ; i < words ; ++i )
+			r._w[ i ] = ~_w[ i ];
+		return r;
+	}
+
+	inline bool operator==( wordpath const & o ) const throw() { return _w == o._w; }
+	inline bool operator!=( wordpath const & o ) const throw() { return _w != o._w; }
+
+private:
+	std::array< std::uint64_t, words >	_w;
+};
@@ -0,0 +1,44 @@
+#include "wordtrie.hpp"
+
+const wordtrie::node wordtrie::dead;
+const std::uint32_t wordtrie::none;
+
+wordtrie::wordtrie( std::size_t letters ) :
+	_stride( letters + 1 )
+{
+	// the dead node and the root
+	grow();
+	grow();
+}
+
+void wordtrie::grow() throw()
+{
+	_nodes.resize( _nodes.size() + _stride, dead );
+	_nodes.back() = none;
+}
+
+void wordtrie::insert( char const * word, std::uint32_t index ) throw()
+{
+	node n = root();
+
+	for ( ; *word ; ++word )
+	{
+		node child = next( n, *word );
+
+		if ( child == dead )
+		{
+			child = static_cast< node >( size() );
+			grow();
+			_nodes[ n * _stride + letterIndex( *word ) ] = child;
+		}
+
+		n = child;
+	}
+
+	_nodes[ n * _stride + _stride - 1 ] = index;
+}
+
+std::size_t wordtrie::size() const throw()
+{
+	return _nodes.size() / _stride;
+}
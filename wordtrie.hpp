@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "alphabet.hpp"
+
+// a prefix tree over the words in the cache. each node holds a child
+// array indexed by letter so following a word one letter at a time is
+// a single array lookup rather than a binary search over the word list.
+// the array is as wide as the word list's alphabet, so an english tree
+// is no bigger for the letters other languages have.
+//
+// node 0 is a "dead" node whose children all point back to itself, this
+// means a search can keep stepping from a dead node without checking for
+// it, it'll simply stay dead.
+class wordtrie
+{
+public:
+	typedef std::uint32_t node;
+
+	static const node dead = 0;
+
+	// the index of a node that isn't the end of a word
+	static const std::uint32_t none = ~std::uint32_t( 0 );
+
+	// letters is the size of the alphabet the words are in
+	explicit wordtrie( std::size_t letters );
+
+	// index is whatever the caller numbers its words by
+	void insert( char const * word, std::uint32_t index ) throw();
+
+	inline node root() const throw() { return 1; }
+
+	inline node next( node n, char c ) const throw() { return _nodes[ n * _stride + letterIndex( c ) ]; }
+
+	inline bool isWord( node n ) const throw() { return index( n ) != none; }
+
+	// the index given for the word ending at a node
+	inline std::uint32_t index( node n ) const throw() { return _nodes[ n * _stride + _stride - 1 ]; }
+
+	std::size_t size() const throw();
+
+private:
+
+	void grow() throw();
+
+	// each node is a child per letter followed by its index
+	std::size_t				_stride;
+	std::vector< node >		_nodes;
+};